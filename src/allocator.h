@@ -0,0 +1,210 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include "./arena.h"
+#include "./pool.h"
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define APC_ALLOCATOR_PMR 1
+#endif
+#endif
+
+namespace apc {
+
+// Standard Allocator for using an `apc::arena` as the backing store of std
+// containers, e.g. std::vector<int, apc::arena_allocator<int>>.
+// deallocate() is a no-op, memory is given back when the arena is reset or
+// destroyed.
+template <typename T>
+class arena_allocator {
+  template <typename U>
+  friend class arena_allocator;
+
+  apc::arena* _arena;
+
+public:
+  typedef T value_type;
+
+  arena_allocator(apc::arena &arena) : _arena(&arena) { }
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &other) : _arena(other._arena) { }
+
+  T* allocate(const size_t count) {
+    T* ptr = _arena->allocate_size<T>(count);
+
+    if(!ptr) throw std::bad_alloc();
+
+    return ptr;
+  }
+
+  void deallocate(T*, size_t) { }
+
+  apc::arena* arena() const {
+    return _arena;
+  }
+
+  template <typename U>
+  bool operator==(const arena_allocator<U> &other) const {
+    return _arena == other._arena;
+  }
+
+  template <typename U>
+  bool operator!=(const arena_allocator<U> &other) const {
+    return _arena != other._arena;
+  }
+};
+
+#ifdef APC_ALLOCATOR_PMR
+
+// std::pmr::memory_resource on top of an `apc::arena`.
+// Like std::pmr::monotonic_buffer_resource, deallocate is a no-op.
+class arena_resource : public std::pmr::memory_resource {
+  apc::arena* _arena;
+
+protected:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* ptr = _arena->allocate_raw(bytes ? bytes : 1, alignment);
+
+    if(!ptr) throw std::bad_alloc();
+
+    return ptr;
+  }
+
+  void do_deallocate(void*, size_t, size_t) override { }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    const arena_resource* resource = dynamic_cast<const arena_resource*>(&other);
+
+    return resource && resource->_arena == _arena;
+  }
+
+public:
+  arena_resource(apc::arena &arena) : _arena(&arena) { }
+
+  apc::arena* arena() const {
+    return _arena;
+  }
+};
+
+template <size_t S>
+struct alignas(std::max_align_t) pool_resource_block {
+  char data[S];
+};
+
+// std::pmr::memory_resource with one `apc::pool` per size bucket
+// (16 to 2048 bytes). Bigger or over-aligned requests go to `upstream`.
+// The pools either manage their own memory or use an `apc::arena`.
+class pool_resource : public std::pmr::memory_resource {
+  apc::pool<pool_resource_block<16>> pool16;
+  apc::pool<pool_resource_block<32>> pool32;
+  apc::pool<pool_resource_block<64>> pool64;
+  apc::pool<pool_resource_block<128>> pool128;
+  apc::pool<pool_resource_block<256>> pool256;
+  apc::pool<pool_resource_block<512>> pool512;
+  apc::pool<pool_resource_block<1024>> pool1024;
+  apc::pool<pool_resource_block<2048>> pool2048;
+  std::pmr::memory_resource* upstream;
+
+  static size_t bucket(const size_t bytes) {
+    if(bytes <= 16) return 0;
+    if(bytes <= 32) return 1;
+    if(bytes <= 64) return 2;
+    if(bytes <= 128) return 3;
+    if(bytes <= 256) return 4;
+    if(bytes <= 512) return 5;
+    if(bytes <= 1024) return 6;
+    if(bytes <= 2048) return 7;
+
+    return 8;
+  }
+
+protected:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* ptr = nullptr;
+
+    if(alignment > alignof(std::max_align_t))
+      return upstream->allocate(bytes, alignment);
+
+    switch(bucket(bytes)) {
+      case 0: ptr = pool16.allocate_raw(); break;
+      case 1: ptr = pool32.allocate_raw(); break;
+      case 2: ptr = pool64.allocate_raw(); break;
+      case 3: ptr = pool128.allocate_raw(); break;
+      case 4: ptr = pool256.allocate_raw(); break;
+      case 5: ptr = pool512.allocate_raw(); break;
+      case 6: ptr = pool1024.allocate_raw(); break;
+      case 7: ptr = pool2048.allocate_raw(); break;
+      default: return upstream->allocate(bytes, alignment);
+    }
+
+    if(!ptr) throw std::bad_alloc();
+
+    return ptr;
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    if(alignment > alignof(std::max_align_t)) {
+      upstream->deallocate(ptr, bytes, alignment);
+
+      return;
+    }
+
+    switch(bucket(bytes)) {
+      case 0: pool16.deallocate(static_cast<pool_resource_block<16>*>(ptr)); break;
+      case 1: pool32.deallocate(static_cast<pool_resource_block<32>*>(ptr)); break;
+      case 2: pool64.deallocate(static_cast<pool_resource_block<64>*>(ptr)); break;
+      case 3: pool128.deallocate(static_cast<pool_resource_block<128>*>(ptr)); break;
+      case 4: pool256.deallocate(static_cast<pool_resource_block<256>*>(ptr)); break;
+      case 5: pool512.deallocate(static_cast<pool_resource_block<512>*>(ptr)); break;
+      case 6: pool1024.deallocate(static_cast<pool_resource_block<1024>*>(ptr)); break;
+      case 7: pool2048.deallocate(static_cast<pool_resource_block<2048>*>(ptr)); break;
+      default: upstream->deallocate(ptr, bytes, alignment);
+    }
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+public:
+  pool_resource(std::pmr::memory_resource* _upstream = std::pmr::get_default_resource()) :
+    upstream(_upstream) { }
+
+  pool_resource(apc::arena &arena,
+    std::pmr::memory_resource* _upstream = std::pmr::get_default_resource()
+  ) : upstream(_upstream) {
+    pool16.init(arena, 0);
+    pool32.init(arena, 0);
+    pool64.init(arena, 0);
+    pool128.init(arena, 0);
+    pool256.init(arena, 0);
+    pool512.init(arena, 0);
+    pool1024.init(arena, 0);
+    pool2048.init(arena, 0);
+  }
+
+  // Blocks in use across all buckets.
+  size_t used() const {
+    return pool16.used() + pool32.used() + pool64.used() + pool128.used() +
+      pool256.used() + pool512.used() + pool1024.used() + pool2048.used();
+  }
+};
+
+#endif
+
+}
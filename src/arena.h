@@ -11,15 +11,52 @@
  */
 #pragma once
 
+#include <cassert>
 #include <cstdlib>
 #include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <string.h>
+#include "./page.h"
+#include "./growth.h"
+#include "./trace.h"
+
+#ifdef APC_PAGE_MMAP
+#define APC_ARENA_VIRTUAL 1
+#endif
 
 #define ARENA_POOL_CPP 1
 
+// Define APC_ARENA_STATS before including this header to enable the
+// allocation counters of arena::stats(). Without it they compile away.
+#if defined(APC_ARENA_STATS) && !defined(APC_ARENA_STATS_TAGS)
+#define APC_ARENA_STATS_TAGS 16
+#endif
+
 namespace apc {
 
+// Index list for unpacking the batch allocations (std::index_sequence is
+// C++14).
+template <size_t... I>
+struct arena_indices { };
+
+template <size_t N, size_t... I>
+struct arena_make_indices : arena_make_indices<N - 1, N - 1, I...> { };
+
+template <size_t... I>
+struct arena_make_indices<0, I...> {
+  typedef arena_indices<I...> type;
+};
+
+// A count of one for every type of a pack.
+template <typename T>
+struct arena_one {
+  static const size_t value = 1;
+};
+
 struct arena_page {
   size_t size;
   size_t used;
@@ -27,26 +64,705 @@ struct arena_page {
   char* buffer;
 };
 
+#ifdef APC_ARENA_STATS
+struct arena_stats {
+  size_t allocations;
+  // Bytes asked for by allocations.
+  size_t requested;
+  // Bytes lost to alignment padding.
+  size_t padding;
+  // Bytes left unused at the end of pages the arena moved past.
+  size_t tail_waste;
+  size_t pages;
+  // Highest number of bytes in use (requested + padding).
+  size_t peak;
+  // Bytes requested per `tag` passed to allocate_raw().
+  size_t tags[APC_ARENA_STATS_TAGS];
+};
+#endif
+
+// Destructor registered by allocate_new_finalized(). Stored inside the
+// arena, and linked newest first.
+struct arena_finalizer {
+  void (*destroy)(void*);
+  void* object;
+  arena_finalizer* next;
+};
+
+// Dedicated page for one large allocation, see arena::large_pages().
+struct arena_large_page {
+  arena_large_page* next;
+  size_t size;
+  size_t used;
+};
+
+struct arena_mark {
+  size_t page;
+  size_t used;
+  arena_finalizer* finalizers;
+  arena_large_page* large;
+};
+
+enum arena_reset_policy {
+  // Keep every page (same as reset()).
+  arena_reset_keep = 0,
+  // Release the pages beyond `retain_size` bytes. Virtual arenas decommit
+  // the memory above `retain_size` instead (MADV_DONTNEED).
+  arena_reset_trim,
+  // Replace all pages with a single page sized to the high-water mark, so
+  // the next cycle bumps through one contiguous block.
+  arena_reset_consolidate,
+};
+
+// Counters for tuning the reset policy.
+struct arena_reset_stats {
+  size_t resets;
+  // Highest used() seen at a reset since the last consolidation.
+  size_t high_water;
+  size_t trims;
+  size_t consolidations;
+  size_t pages_released;
+  size_t bytes_released;
+};
+
+#ifndef APC_ARENA_CACHE_BUCKETS
+#define APC_ARENA_CACHE_BUCKETS 48
+#endif
+
+// Keeps the pages of destroyed (or trimmed) arenas in power-of-two size
+// buckets, and hands them to new arenas, so per-request arenas do not go
+// back to malloc/free every time.
+// Not thread-safe, use one cache per thread, e.g. arena_cache::local().
+class arena_cache {
+private:
+  void* buckets[APC_ARENA_CACHE_BUCKETS];
+  size_t _cached = 0;
+  size_t _max_cached;
+  unsigned _flags;
+  size_t _hits = 0;
+  size_t _misses = 0;
+
+  static size_t bucket(const size_t size) {
+    size_t index = 0;
+
+    while((static_cast<size_t>(1) << index) < size) index++;
+
+    return index;
+  }
+
+public:
+  // Keeps at most `max_cached` bytes of pages. `flags` is a combination of
+  // `page_flags`, used for every page of the cache.
+  arena_cache(const size_t max_cached = 64 * 1024 * 1024,
+    const unsigned flags = page_default
+  ) : _max_cached(max_cached), _flags(flags) {
+    for(size_t i = 0; i < APC_ARENA_CACHE_BUCKETS; i++)
+      buckets[i] = nullptr;
+  }
+
+  arena_cache(const arena_cache&) = delete;
+  arena_cache& operator=(const arena_cache&) = delete;
+
+  ~arena_cache() {
+    clear();
+  }
+
+  static arena_cache& local() {
+    static thread_local arena_cache cache;
+
+    return cache;
+  }
+
+  // Pages are rounded up to the next power of two (at least 64 bytes).
+  static size_t round(const size_t size) {
+    return static_cast<size_t>(1) << bucket(size < 64 ? 64 : size);
+  }
+
+  // `size` must be a rounded size.
+  void* acquire(const size_t size) {
+    const size_t index = bucket(size);
+
+    if(index < APC_ARENA_CACHE_BUCKETS && buckets[index]) {
+      void* ptr = buckets[index];
+      buckets[index] = *static_cast<void**>(ptr);
+      _cached -= size;
+      _hits++;
+
+      return ptr;
+    }
+
+    _misses++;
+
+    return page_allocate(size, _flags);
+  }
+
+  void release(void* ptr, const size_t size) {
+    if(!ptr) return;
+
+    const size_t index = bucket(size);
+
+    if(index >= APC_ARENA_CACHE_BUCKETS || _cached + size > _max_cached) {
+      page_free(ptr, size, _flags);
+
+      return;
+    }
+
+    *static_cast<void**>(ptr) = buckets[index];
+    buckets[index] = ptr;
+    _cached += size;
+  }
+
+  // Free all cached pages.
+  void clear() {
+    for(size_t i = 0; i < APC_ARENA_CACHE_BUCKETS; i++) {
+      while(buckets[i]) {
+        void* ptr = buckets[i];
+        buckets[i] = *static_cast<void**>(ptr);
+        page_free(ptr, static_cast<size_t>(1) << i, _flags);
+      }
+    }
+
+    _cached = 0;
+  }
+
+  size_t cached() const {
+    return _cached;
+  }
+
+  size_t hits() const {
+    return _hits;
+  }
+
+  size_t misses() const {
+    return _misses;
+  }
+
+  unsigned flags() const {
+    return _flags;
+  }
+};
+
 class arena {
 private:
   arena* parent = nullptr;
+  // Generation of the parent when the child was made. After a parent
+  // reset or rewind the pages of the child may be handed out again, so
+  // they are not given back.
+  size_t parent_generation = 0;
+  // Bumped by reset() and rewind().
+  size_t generation = 0;
+  // Child arenas alive, which must all be destroyed before this arena.
+  size_t children = 0;
   arena_page* pages = nullptr;
   size_t pages_size = 0;
+  size_t current = 0;
+  bool _best_fit = false;
+  unsigned _flags = page_default;
+  size_t _page_alignment = 0;
+  size_t _warm_ahead = 0;
+  // Warming ahead failed, do not try again on every allocation until the
+  // arena grew or the growth policy changed.
+  bool _warm_failed = false;
+  growth_policy _growth;
+  arena_cache* cache = nullptr;
+  arena_reset_stats _reset_stats = { 0, 0, 0, 0, 0, 0 };
+  arena_finalizer* finalizers = nullptr;
+  size_t _large_threshold = 0;
+  bool _large_keep = false;
+  arena_large_page* large = nullptr;
+  arena_large_page* large_free = nullptr;
+
+  #ifdef APC_ARENA_STATS
+  arena_stats _stats = {};
+  size_t in_use = 0;
+  #endif
+
+  template <typename T>
+  static void destroy_object(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  // Run the registered destructors in reverse order, until `until`.
+  void run_finalizers(const arena_finalizer* until = nullptr) {
+    while(finalizers && finalizers != until) {
+      arena_finalizer* finalizer = finalizers;
+      finalizers = finalizer->next;
+      finalizer->destroy(finalizer->object);
+    }
+  }
+
+  // Virtual memory mode, see reserve().
+  size_t reserved = 0;
+  arena_page virtual_page = { 0, 0, nullptr, nullptr };
+
+  // Bytes needed to align `address` to `alignment`, which must be a power
+  // of two.
+  static size_t align_padding(const void* address, const size_t alignment) {
+    return (0 - reinterpret_cast<uintptr_t>(address)) & (alignment - 1);
+  }
+
+  // `value` rounded up to `alignment`, which must be a power of two. Wraps
+  // around to a smaller value on overflow.
+  static size_t align_up(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  // Size of the memory block of `page`, including the page headers that
+  // are stored in front of the buffer.
+  static size_t block_size(const arena_page &page) {
+    return (page.buffer - static_cast<char*>(page.target)) + page.size;
+  }
+
+  template <typename... Ts, size_t... I>
+  static std::tuple<Ts*...> batch_pointers(char* base, const size_t* offsets,
+    arena_indices<I...>
+  ) {
+    return std::tuple<Ts*...>(
+      base ? reinterpret_cast<Ts*>(base + offsets[I]) : nullptr...
+    );
+  }
+
+  void* bump(arena_page &page, const size_t size, const size_t alignment) {
+    if(page.size - page.used < size) return nullptr;
+
+    size_t padding = align_padding(page.buffer + page.used, alignment);
+    size_t new_size = padding + size;
+
+    if(page.size - page.used < new_size) return nullptr;
+
+    char* new_allocation = page.buffer + page.used + padding;
+    page.used += new_size;
+
+    #ifdef APC_ARENA_STATS
+    _stats.allocations++;
+    _stats.requested += size;
+    _stats.padding += padding;
+    in_use += new_size;
+    if(in_use > _stats.peak) _stats.peak = in_use;
+    #endif
+
+    return static_cast<void*>(new_allocation);
+  }
+
+  // Move the cursor forward to `next`, the tails of the pages in between
+  // can no longer be used.
+  void leave_pages(const size_t next) {
+    #ifdef APC_ARENA_STATS
+    for(size_t i = current; i < next; i++)
+      _stats.tail_waste += pages[i].size - pages[i].used;
+    #endif
+
+    current = next;
+  }
+
+  // Commit more of the reserved range, so that at least `size` bytes of
+  // the virtual page are usable.
+  bool commit(const size_t size) {
+    #ifdef APC_ARENA_VIRTUAL
+    if(size > reserved) return false;
+    if(size <= virtual_page.size) return true;
+
+    const size_t os_page = page_os_size();
+    size_t new_size = virtual_page.size * 2;
+
+    if(new_size < size) new_size = size;
+
+    new_size = (new_size + os_page - 1) / os_page * os_page;
+
+    if(new_size > reserved) new_size = reserved;
+
+    if(mprotect(
+      virtual_page.buffer + virtual_page.size,
+      new_size - virtual_page.size,
+      PROT_READ | PROT_WRITE
+    ) != 0) return false;
+
+    if(_flags & page_prefault)
+      page_touch(virtual_page.buffer + virtual_page.size, new_size - virtual_page.size);
+
+    virtual_page.size = new_size;
+    _warm_failed = false;
+
+    return true;
+    #else
+    return false;
+    #endif
+  }
+
+  // Give back the committed memory of a virtual arena above `size` bytes.
+  void decommit(size_t size) {
+    #ifdef APC_ARENA_VIRTUAL
+    const size_t os_page = page_os_size();
+
+    size = (size + os_page - 1) / os_page * os_page;
+
+    if(size >= virtual_page.size) return;
+
+    const size_t released = virtual_page.size - size;
+
+    madvise(virtual_page.buffer + size, released, MADV_DONTNEED);
+    mprotect(virtual_page.buffer + size, released, PROT_NONE);
+
+    virtual_page.size = size;
+
+    _reset_stats.trims++;
+    _reset_stats.bytes_released += released;
+    #else
+    (void)size;
+    #endif
+  }
+
+  // Allocate the memory for a page, `size` is updated to the usable size.
+  void* page_block_allocate(size_t &size) {
+    if(cache) {
+      size = arena_cache::round(size);
+
+      return cache->acquire(size);
+    }
+
+    // Huge pages round up the allocation, the extra space is usable.
+    size = page_round(size, _flags);
+
+    return page_allocate(size, _flags, _page_alignment);
+  }
+
+  void page_block_free(void* ptr, const size_t size) {
+    if(cache) cache->release(ptr, size);
+    else page_free(ptr, size, _flags);
+  }
+
+  // Free the pages after the first `count` pages.
+  void release_pages_after(const size_t count) {
+    if(!count || count >= pages_size) return;
+
+    for(size_t i = count; i < pages_size; i++) {
+      _reset_stats.bytes_released += page_round(block_size(pages[i]), _flags);
+      _reset_stats.pages_released++;
+    }
+
+    // Every page block starts with a copy of the headers of all pages
+    // before it, so the block of the last kept page holds a header array
+    // for the pages that remain (with stale `used` values).
+    arena_page* kept = reinterpret_cast<arena_page*>(pages[count - 1].target);
+    const size_t old_size = pages_size;
+    arena_page* old_pages = pages;
+
+    for(size_t i = count; i < old_size; i++)
+      page_block_free(old_pages[i].target, block_size(old_pages[i]));
+
+    pages = kept;
+    pages_size = count;
+
+    for(size_t i = 0; i < pages_size; i++)
+      pages[i].used = 0;
+
+    _reset_stats.trims++;
+  }
+
+  static size_t large_header_size() {
+    const size_t alignment = alignof(std::max_align_t);
+
+    return (sizeof(arena_large_page) + alignment - 1) & ~(alignment - 1);
+  }
+
+  void free_large(arena_large_page* page) {
+    page_free(page, large_header_size() + page->size, _flags);
+  }
+
+  // Release the large pages allocated after `until`, either back to the
+  // system or to the `large_free` list for reuse.
+  void drop_large(const arena_large_page* until = nullptr, const bool keep = false) {
+    while(large && large != until) {
+      arena_large_page* page = large;
+      large = page->next;
+
+      if(keep) {
+        page->used = 0;
+        page->next = large_free;
+        large_free = page;
+      } else
+        free_large(page);
+    }
+  }
+
+  void* allocate_large(const size_t size, const size_t alignment) {
+    const size_t header_size = large_header_size();
+    const size_t needed = size +
+      (alignment > alignof(std::max_align_t) ? alignment : 0);
+    arena_large_page* page = nullptr;
+
+    for(arena_large_page** link = &large_free; *link; link = &(*link)->next) {
+      if((*link)->size >= needed) {
+        page = *link;
+        *link = page->next;
+
+        break;
+      }
+    }
+
+    if(!page) {
+      const size_t total = page_round(header_size + needed, _flags);
+
+      page = static_cast<arena_large_page*>(page_allocate(total, _flags));
+
+      if(!page) return nullptr;
+
+      page->size = total - header_size;
+    }
+
+    page->next = large;
+    large = page;
+
+    char* buffer = reinterpret_cast<char*>(page) + header_size;
+    size_t padding = align_padding(buffer, alignment);
+
+    page->used = padding + size;
+
+    #ifdef APC_ARENA_STATS
+    _stats.allocations++;
+    _stats.requested += size;
+    _stats.padding += padding;
+    in_use += page->used;
+    if(in_use > _stats.peak) _stats.peak = in_use;
+    #endif
+
+    return static_cast<void*>(buffer + padding);
+  }
+
+  // Free the large pages kept for reuse, returns the bytes released.
+  size_t release_large_free() {
+    size_t released = 0;
+
+    while(large_free) {
+      arena_large_page* page = large_free;
+      large_free = page->next;
+      released += large_header_size() + page->size;
+      free_large(page);
+    }
+
+    return released;
+  }
+
+  // Give the pages after the first `keep` pages back to the parent, newest
+  // first, for as long as they are the last allocations of the parent.
+  // Returns the number of pages left.
+  size_t return_pages(const size_t keep) {
+    if(parent->generation != parent_generation) return pages_size;
+
+    while(pages_size > keep) {
+      const size_t i = pages_size - 1;
+
+      if(!parent->free_last(pages[i].target, block_size(pages[i])))
+        break;
+
+      pages_size--;
+    }
+
+    // The block of the last page left holds a header array for the pages
+    // before it (with stale `used` values).
+    if(pages_size) {
+      arena_page* last = reinterpret_cast<arena_page*>(pages[pages_size - 1].target);
+
+      for(size_t i = 0; i < pages_size; i++) {
+        last[i].used = pages[i].used;
+      }
+
+      pages = last;
+    }
+
+    if(current >= pages_size) current = pages_size ? pages_size - 1 : 0;
+
+    return pages_size;
+  }
+
+  void release() {
+    run_finalizers();
+    drop_large();
+    release_large_free();
+
+    // Child arenas give their pages back to the parent, if nothing else
+    // was allocated in the parent after them.
+    if(parent && pages_size) return_pages(0);
+
+    #ifdef APC_ARENA_VIRTUAL
+    if(reserved) {
+      munmap(virtual_page.target, reserved);
+      virtual_page = { 0, 0, nullptr, nullptr };
+      reserved = 0;
+    } else
+    #endif
+    if(!parent) {
+      for(size_t i = 0; i < pages_size; i++)
+        page_block_free(pages[i].target, block_size(pages[i]));
+    }
+
+    pages = nullptr;
+    pages_size = 0;
+    current = 0;
+
+    #ifdef APC_ARENA_STATS
+    in_use = 0;
+    #endif
+  }
+
+  // Add a page of at least `size` bytes, sized by the growth policy.
+  bool grow_next(const size_t size) {
+    // Large pages do not count towards the growth of the normal pages, but
+    // they do count towards the limit.
+    size_t total = 0;
+
+    for(size_t i = 0; i < pages_size; i++)
+      total += pages[i].size;
+
+    growth_policy policy = _growth;
+
+    if(policy.max_size) {
+      const size_t large = this->size() - total;
+
+      if(large >= policy.max_size) return false;
+
+      policy.max_size -= large;
+    }
+
+    // The built-in growth doubles the size of the last page.
+    const size_t builtin = pages_size ? pages[pages_size - 1].size * 2 : 0;
+    const size_t next = policy.next(total, total + size, total + builtin);
+
+    return next && grow(next - total);
+  }
+
+  // Grow (or commit) `bytes` more, and touch only the memory that was
+  // added.
+  bool grow_warm(const size_t bytes) {
+    if(reserved) {
+      const size_t committed = virtual_page.size;
+
+      if(!commit(committed + bytes)) return false;
+
+      if(!(_flags & page_prefault))
+        page_touch(virtual_page.buffer + committed, virtual_page.size - committed);
+
+      return true;
+    }
+
+    if(!grow_next(bytes)) return false;
+
+    if(!(_flags & page_prefault))
+      page_touch(pages[pages_size - 1].buffer, pages[pages_size - 1].size);
+
+    return true;
+  }
+
+  // Warm the next page once the current page has less than `_warm_ahead`
+  // bytes left, see warm_ahead().
+  void warm_next() {
+    if(_warm_failed || current + 1 < pages_size) return;
+
+    const size_t available = pages[current].size - pages[current].used;
+
+    if(available < _warm_ahead && !grow_warm(_warm_ahead - available))
+      _warm_failed = true;
+  }
+
+  void* allocate_slow(const size_t size, const size_t alignment) {
+    // A virtual arena is a single contiguous page, so it commits more of
+    // its reservation instead of adding pages.
+    if(reserved) {
+      size_t padding = align_padding(virtual_page.buffer + virtual_page.used, alignment);
+
+      if(!commit(virtual_page.used + padding + size)) return nullptr;
+
+      return bump(virtual_page, size, alignment);
+    }
+
+    if(_best_fit && current) {
+      arena_page* best = nullptr;
+
+      for(size_t i = 0; i < current; i++) {
+        const size_t available = pages[i].size - pages[i].used;
+
+        if(available < size) continue;
+        if(best && available >= best->size - best->used) continue;
+
+        size_t padding = align_padding(pages[i].buffer + pages[i].used, alignment);
+
+        if(available >= padding + size) best = &pages[i];
+      }
+
+      if(best) return bump(*best, size, alignment);
+    }
+
+    // Pages after the cursor are only non-empty if a reset() moved the
+    // cursor back, so they are tried before growing.
+    for(size_t i = current + 1; i < pages_size; i++) {
+      void* ptr = bump(pages[i], size, alignment);
+
+      if(ptr) {
+        leave_pages(i);
+
+        return ptr;
+      }
+    }
+
+    const size_t total = this->size();
+
+    // Large allocations get their own page, so they do not inflate the
+    // geometric growth of the normal pages.
+    if(_large_threshold && size >= _large_threshold && !parent) {
+      if(!_growth.next(total, total + size, total + size)) return nullptr;
+
+      return allocate_large(size, alignment);
+    }
+
+    if(!grow_next(size + alignment)) return nullptr;
+
+    leave_pages(pages_size - 1);
+
+    return bump(pages[current], size, alignment);
+  }
 
 public:
-  arena(const size_t size) {
+  // `flags` is a combination of `page_flags`, and controls how the pages
+  // of the arena are allocated (huge pages, prefaulting).
+  // `page_alignment` (a power of two, 0 for the default) aligns the start
+  // of every page, see page_alignment().
+  arena(const size_t size, const unsigned flags = page_default,
+    const size_t page_alignment = 0
+  ) : _flags(flags), _page_alignment(page_alignment) {
+    if(size) grow(size);
+  }
+
+  // A child arena takes its pages from `parent`, and gives them back when
+  // it is reset or destroyed. The child must be destroyed before the
+  // parent (asserted in debug builds). Pages are not given back once the
+  // parent has been reset or rewound after the child was made, since the
+  // parent may have handed that memory out again.
+  arena(arena &parent, const size_t size, const size_t page_alignment = 0) :
+    parent(&parent), parent_generation(parent.generation),
+    _page_alignment(page_alignment)
+  {
+    parent.children++;
+
     if(size) grow(size);
   }
 
-  arena(arena &parent, const size_t size) : parent(&parent) {
+  // Take pages from, and give them back to `cache`. Pages are rounded up to
+  // a power of two, and use the flags of the cache. They are aligned to
+  // max_align_t, see page_alignment().
+  arena(arena_cache &_cache, const size_t size) :
+    _flags(_cache.flags()), cache(&_cache)
+  {
     if(size) grow(size);
   }
 
   ~arena() {
-    if(!parent) {
-      for(size_t i = 0; i < pages_size; i++)
-        free(pages[i].target);
-    }
+    APC_TRACE_EVENT(trace_arena_release, this, nullptr, 0);
+
+    assert(!children && "child arenas must be destroyed before their parent");
+
+    release();
+
+    if(parent) parent->children--;
   }
 
   template <typename T, typename... Args>
@@ -58,6 +774,35 @@ public:
     return new (new_item) T(std::forward<Args>(args)...);
   }
 
+  // Same as allocate_new(), but the destructor of the object is run on
+  // reset(), rewind() past it, and when the arena is destroyed.
+  // For trivially destructible types this is exactly allocate_new().
+  template <typename T, typename... Args>
+  T* allocate_new_finalized(Args&&... args) {
+    if(std::is_trivially_destructible<T>::value)
+      return allocate_new<T>(std::forward<Args>(args)...);
+
+    T* new_item = allocate_new<T>(std::forward<Args>(args)...);
+
+    if(!new_item) return nullptr;
+
+    // An object without a finalizer would never be destroyed, so it is
+    // taken back if there is no room for the finalizer.
+    arena_finalizer* finalizer = allocate_size<arena_finalizer>();
+
+    if(!finalizer) {
+      new_item->~T();
+      free_last(new_item, sizeof(T));
+
+      return nullptr;
+    }
+
+    *finalizer = { &destroy_object<T>, new_item, finalizers };
+    finalizers = finalizer;
+
+    return new_item;
+  }
+
   template <typename T>
   T* allocate_size(const size_t count = 1) {
     if(!count) return nullptr;
@@ -68,6 +813,71 @@ public:
     return static_cast<T*>(allocate_raw(size, alignment));
   }
 
+  // Same as allocate_size(), but aligned to at least `A` bytes, e.g.
+  // allocate_aligned<float, 64>(n) for AVX-512 kernels.
+  template <typename T, size_t A>
+  T* allocate_aligned(const size_t count = 1) {
+    static_assert(A && !(A & (A - 1)), "Alignment must be a power of two");
+
+    if(!count) return nullptr;
+
+    return static_cast<T*>(allocate_raw(sizeof(T) * count,
+      A > alignof(T) ? A : alignof(T)));
+  }
+
+  // Allocate and construct `count` objects of type T in one bump, each
+  // constructed with a copy of `args`.
+  template <typename T, typename... Args>
+  T* allocate_new_n(const size_t count, const Args&... args) {
+    T* items = allocate_size<T>(count);
+
+    if(!items) return nullptr;
+
+    for(size_t i = 0; i < count; i++)
+      new (&items[i]) T(args...);
+
+    return items;
+  }
+
+  // Reserve room for `counts[i]` objects of each type in Ts in one bump.
+  // Like allocate_size() the memory is not constructed.
+  // auto nodes = arena.allocate_batch<Node, Edge>({ 10, 20 });
+  // All pointers are nullptr if the allocation fails, or the total size
+  // does not fit in a size_t.
+  template <typename... Ts>
+  std::tuple<Ts*...> allocate_batch(const size_t (&counts)[sizeof...(Ts)]) {
+    const size_t sizes[] = { sizeof(Ts)... };
+    const size_t alignments[] = { alignof(Ts)... };
+    size_t offsets[sizeof...(Ts)];
+    size_t total = 0;
+    size_t alignment = 1;
+
+    for(size_t i = 0; i < sizeof...(Ts); i++) {
+      const size_t offset = align_up(total, alignments[i]);
+
+      if(offset < total || counts[i] > (static_cast<size_t>(-1) - offset) / sizes[i])
+        return std::tuple<Ts*...>();
+
+      offsets[i] = offset;
+      total = offset + sizes[i] * counts[i];
+
+      if(alignments[i] > alignment) alignment = alignments[i];
+    }
+
+    char* base = static_cast<char*>(allocate_raw(total, alignment));
+
+    return batch_pointers<Ts...>(base, offsets,
+      typename arena_make_indices<sizeof...(Ts)>::type());
+  }
+
+  // One object of each type in Ts.
+  template <typename... Ts>
+  std::tuple<Ts*...> allocate_batch() {
+    const size_t counts[sizeof...(Ts)] = { arena_one<Ts>::value... };
+
+    return allocate_batch<Ts...>(counts);
+  }
+
   template <typename T, bool FORCE_TRIVIAL_COPY = false>
   T* allocate(T& item) {
     T* new_item = allocate_size<T>();
@@ -103,62 +913,272 @@ public:
     return new_item;
   }
 
+  // `alignment` must be a power of two.
+  // `tag` is only used by the per-tag counters of stats() (APC_ARENA_STATS).
   void* allocate_raw(const size_t size,
-    const size_t alignment = alignof(std::max_align_t)
+    const size_t alignment = alignof(std::max_align_t),
+    const unsigned tag = 0
   ) {
     if(!size) return nullptr;
 
-    for(size_t i = 0; i <= pages_size; i++) {
-      arena_page *page;
-      char* buffer;
+    void* ptr = nullptr;
 
-      if(i == pages_size) {
-        const size_t grow_size = i == 0 ? size + alignment :
-          pages[i - 1].size * 2;
+    // Fast path: bump the pointer on the current page.
+    if(pages_size) {
+      ptr = bump(pages[current], size, alignment);
 
-        if(!grow(grow_size)) break; 
-      }
+      if(ptr && _warm_ahead) warm_next();
+    }
+
+    if(!ptr) ptr = allocate_slow(size, alignment);
 
-      page = &pages[i];
-      buffer = page->buffer + page->used;
+    #ifdef APC_ARENA_STATS
+    if(ptr && tag < APC_ARENA_STATS_TAGS) _stats.tags[tag] += size;
+    #else
+    (void)tag;
+    #endif
 
-      if(page->size - page->used < size) continue; 
+    APC_TRACE_EVENT(trace_arena_allocate, this, ptr, size, alignment);
 
-      uintptr_t current_addr = reinterpret_cast<uintptr_t>(buffer);
-      size_t padding = (alignment - (current_addr % alignment)) % alignment;
-      size_t new_size = padding + size;
+    return ptr;
+  }
 
-      if(page->size - page->used < new_size) continue;
+  // Grow (or shrink) the allocation at `ptr` from `old_size` to `new_size`
+  // bytes in place. Only succeeds if it is the last allocation on the
+  // current page, and the page has room for it.
+  bool try_extend(void* ptr, const size_t old_size, const size_t new_size) {
+    if(!ptr || !pages_size) return false;
 
-      char* new_allocation = buffer + padding;
-      page->used += new_size;
+    arena_page &page = pages[current];
+    char* start = static_cast<char*>(ptr);
 
-      return static_cast<void*>(new_allocation);
+    if(start + old_size != page.buffer + page.used) return false;
+
+    const size_t offset = start - page.buffer;
+
+    if(reserved && !commit(offset + new_size)) return false;
+    if(page.size - offset < new_size) return false;
+
+    page.used = offset + new_size;
+
+    #ifdef APC_ARENA_STATS
+    if(new_size > old_size) {
+      _stats.requested += new_size - old_size;
+      in_use += new_size - old_size;
+      if(in_use > _stats.peak) _stats.peak = in_use;
+    } else
+      in_use -= old_size - new_size;
+    #endif
+
+    APC_TRACE_EVENT(trace_arena_extend, this, ptr, new_size);
+
+    return true;
+  }
+
+  // Give back the allocation at `ptr` if it is the last allocation on the
+  // current page, so the next allocation reuses the space.
+  bool free_last(void* ptr, const size_t size) {
+    if(!ptr || !pages_size) return false;
+
+    char* start = static_cast<char*>(ptr);
+    size_t page = current;
+
+    // If the current page is empty, the last allocation may be at the end
+    // of the page before it. The cursor only moves back once it is found.
+    while(start + size != pages[page].buffer + pages[page].used) {
+      if(pages[page].used || !page) return false;
+
+      page--;
     }
 
-    return nullptr;
+    const size_t used = start - pages[page].buffer;
+
+    #ifdef APC_ARENA_STATS
+    in_use -= pages[page].used - used;
+    #endif
+
+    current = page;
+    pages[current].used = used;
+
+    APC_TRACE_EVENT(trace_arena_free_last, this, ptr, size);
+
+    return true;
+  }
+
+  // When enabled, an allocation that does not fit on the current page will
+  // first look for the best fitting free space on the pages before it,
+  // before moving on to the next page or growing the arena.
+  void best_fit(const bool enable) {
+    _best_fit = enable;
+  }
+
+  bool best_fit() const {
+    return _best_fit;
+  }
+
+  // Align the start of pages allocated from now on to `alignment` bytes (a
+  // power of two, 0 for the default), e.g. 64 for cache lines or 4096 for
+  // O_DIRECT buffers. Allocations with up to that alignment then need no
+  // padding at the start of a page.
+  // Pages from an `arena_cache` are only aligned to max_align_t, so a
+  // cached arena refuses larger alignments and returns false.
+  bool page_alignment(const size_t alignment) {
+    if(cache && alignment > alignof(std::max_align_t)) return false;
+
+    _page_alignment = alignment;
+
+    return true;
+  }
+
+  size_t page_alignment() const {
+    return _page_alignment;
+  }
+
+  // Touch the free memory of the current page and the pages after it (or
+  // the committed memory of a reserved arena), so the allocations that
+  // land there do not take page faults.
+  void prefault() {
+    for(size_t i = current; i < pages_size; i++)
+      page_touch(pages[i].buffer + pages[i].used, pages[i].size - pages[i].used);
+  }
+
+  // Make sure `bytes` more can be allocated without page faults: grows (or
+  // commits) ahead of time if there is less room than that, and prefaults.
+  bool warm(const size_t bytes) {
+    size_t available = 0;
+
+    for(size_t i = current; i < pages_size; i++)
+      available += pages[i].size - pages[i].used;
+
+    prefault();
+
+    return available >= bytes || grow_warm(bytes - available);
+  }
+
+  // Once the last page has less than `bytes` left, grow the next page (or
+  // commit more of a reserved arena) and touch just that memory, instead
+  // of growing and faulting when the page is full. This runs synchronously,
+  // in the allocation that crossed the mark. Once it fails (e.g. at the
+  // growth limit) it is not tried again until the arena grows, or the
+  // growth policy or `bytes` change. 0 (the default) disables it.
+  void warm_ahead(const size_t bytes) {
+    _warm_ahead = bytes;
+    _warm_failed = false;
+  }
+
+  size_t warm_ahead() const {
+    return _warm_ahead;
+  }
+
+  // How new pages are sized when the arena runs out of room, see
+  // `growth_policy`. The limit also applies to large pages.
+  void growth(const growth_policy &policy) {
+    _growth = policy;
+    _warm_failed = false;
+  }
+
+  const growth_policy& growth() const {
+    return _growth;
+  }
+
+  // Allocations of at least `threshold` bytes that do not fit on the current
+  // page get a dedicated page of exactly their size, instead of growing the
+  // arena. They are freed by reset() and rewind(), or kept for reuse by
+  // later large allocations if `keep` is true. 0 disables it (default).
+  // Not used by child arenas and virtual arenas.
+  void large_pages(const size_t threshold, const bool keep = false) {
+    _large_threshold = threshold;
+    _large_keep = keep;
+  }
+
+  size_t large_threshold() const {
+    return _large_threshold;
   }
 
+  // Frees the pages and starts over with one page of `size` bytes. Fails
+  // while child arenas are alive, since they use the pages.
   bool resize(const size_t size) {
-    if(!parent) {
-      for(size_t i = 0; i < pages_size; i++)
-        free(pages[i].target);
-    }
+    if(children) return false;
 
-    pages = nullptr;
-    pages_size = 0;
+    release();
 
     return grow(size);
   }
 
+  // Switch to virtual memory mode. Frees the current pages, reserves
+  // `reserve_size` bytes of address space up-front, and commits it on
+  // demand as allocations need it. The arena is then one contiguous page
+  // that never moves, and can not grow past `reserve_size`.
+  // Not supported for child arenas, arenas with child arenas alive, or on
+  // platforms without mmap.
+  bool reserve(const size_t reserve_size, const size_t commit_size = 0) {
+    #ifdef APC_ARENA_VIRTUAL
+    if(parent || children || !reserve_size) return false;
+
+    release();
+
+    void* range = mmap(nullptr, reserve_size, PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(range == MAP_FAILED) return false;
+
+    #ifdef MADV_HUGEPAGE
+    if(_flags & page_huge) madvise(range, reserve_size, MADV_HUGEPAGE);
+    #endif
+
+    if(_flags & page_numa) page_bind(range, reserve_size, page_flags_node(_flags));
+
+    virtual_page = {
+      0, // size (committed)
+      0, // used
+      range, // target
+      static_cast<char*>(range), // buffer
+    };
+
+    reserved = reserve_size;
+    pages = &virtual_page;
+    pages_size = 1;
+
+    if(commit_size && !commit(commit_size)) {
+      release();
+
+      return false;
+    }
+
+    return true;
+    #else
+    (void)reserve_size;
+    (void)commit_size;
+
+    return false;
+    #endif
+  }
+
+  size_t reserved_size() const {
+    return reserved;
+  }
+
+  unsigned flags() const {
+    return _flags;
+  }
+
   bool grow(const size_t size) {
-    const size_t new_size = (sizeof(arena_page) * (pages_size + 1)) + size;
+    if(reserved) return commit(virtual_page.size + size);
+
+    size_t header_size = sizeof(arena_page) * (pages_size + 1);
+
+    // Pad the headers so the buffer starts on the page alignment.
+    if(_page_alignment)
+      header_size = (header_size + _page_alignment - 1) & ~(_page_alignment - 1);
+
+    size_t new_size = header_size + size;
     char* new_page;
     
     if(!parent)
-      new_page = static_cast<char*>(malloc(new_size)); 
+      new_page = static_cast<char*>(page_block_allocate(new_size)); 
     else
-      new_page = static_cast<char*>(parent->allocate_raw(new_size));
+      new_page = static_cast<char*>(parent->allocate_raw(new_size,
+        _page_alignment ? _page_alignment : alignof(std::max_align_t)));
 
     if(!new_page) return false;
 
@@ -166,29 +1186,164 @@ public:
       memcpy(new_page, pages, sizeof(arena_page) * pages_size);
 
     reinterpret_cast<arena_page*>(new_page)[pages_size] = {
-      size, // size
+      new_size - header_size, // size
       0, // used
       new_page, // target
-      new_page + (sizeof(arena_page) * (pages_size + 1)), // buffer
+      new_page + header_size, // buffer
     }; 
 
     pages = reinterpret_cast<arena_page*>(new_page);
     pages_size++;
+    _warm_failed = false;
 
     return true;
   }
 
+  // Child arenas keep their first page, and give the pages they grew
+  // back to the parent if possible.
   void reset() {
-    for(size_t i = 0; i < pages_size; i++)
+    APC_TRACE_EVENT(trace_arena_reset, this, nullptr, 0);
+
+    run_finalizers();
+    drop_large(nullptr, _large_keep);
+
+    size_t count = 0;
+
+    for(size_t i = 0; i < pages_size; i++) {
+      count += pages[i].used;
       pages[i].used = 0;
+    }
+
+    if(parent && pages_size > 1) return_pages(1);
+
+    current = 0;
+
+    #ifdef APC_ARENA_STATS
+    in_use = 0;
+    #endif
+
+    generation++;
+    _reset_stats.resets++;
+    if(count > _reset_stats.high_water) _reset_stats.high_water = count;
   }
 
+  // Reset, and then shrink the memory held by the arena according to
+  // `policy`. Child arenas only reset, which already gives grown pages back
+  // to the parent. Arenas with child arenas alive also only reset, since
+  // the children may still be using pages that would be freed.
+  void reset(const arena_reset_policy policy, const size_t retain_size = 0) {
+    reset();
+
+    if(parent || children || policy == arena_reset_keep) return;
+
+    _reset_stats.bytes_released += release_large_free();
+
+    if(!pages_size) return;
+
+    if(reserved) {
+      decommit(policy == arena_reset_trim ? retain_size : _reset_stats.high_water);
+
+      if(policy == arena_reset_consolidate) {
+        _reset_stats.consolidations++;
+        _reset_stats.high_water = 0;
+      }
+
+      return;
+    }
+
+    if(policy == arena_reset_trim) {
+      // Always keep the first page.
+      size_t kept = 1;
+      size_t kept_size = pages[0].size;
+
+      while(kept < pages_size && kept_size + pages[kept].size <= retain_size) {
+        kept_size += pages[kept].size;
+        kept++;
+      }
+
+      release_pages_after(kept);
+
+      return;
+    }
+
+    // Room for the alignment padding that may land differently once all
+    // allocations share a single page.
+    const size_t target = _reset_stats.high_water +
+      (pages_size * alignof(std::max_align_t));
+
+    _reset_stats.consolidations++;
+    _reset_stats.high_water = 0;
+
+    if(pages_size == 1 && pages[0].size >= target) return;
+
+    for(size_t i = 0; i < pages_size; i++) {
+      _reset_stats.bytes_released += page_round(block_size(pages[i]), _flags);
+      _reset_stats.pages_released++;
+    }
+
+    release();
+    grow(target);
+  }
+
+  const arena_reset_stats& reset_stats() const {
+    return _reset_stats;
+  }
+
+  // Savepoint of the current bump position, which can later be restored with
+  // rewind() to release everything allocated after it.
+  arena_mark mark() const {
+    if(!pages_size) return { 0, 0, finalizers, large };
+
+    return { current, pages[current].used, finalizers, large };
+  }
+
+  // Release all allocations made after `m`. Allocations placed on pages
+  // before the mark by best_fit() are not released.
+  void rewind(const arena_mark &m) {
+    if(m.page >= pages_size || m.page > current) return;
+
+    run_finalizers(m.finalizers);
+    drop_large(m.large, _large_keep);
+
+    for(size_t i = m.page + 1; i <= current; i++)
+      pages[i].used = 0;
+
+    if(m.used < pages[m.page].used) pages[m.page].used = m.used;
+
+    current = m.page;
+    generation++;
+
+    #ifdef APC_ARENA_STATS
+    in_use = used();
+    #endif
+  }
+
+  #ifdef APC_ARENA_STATS
+  arena_stats stats() const {
+    arena_stats copy = _stats;
+    copy.pages = pages_size;
+
+    return copy;
+  }
+
+  void clear_stats() {
+    _stats = {};
+    in_use = used();
+  }
+  #endif
+
   size_t size() const {
     size_t count = 0;
 
     for(size_t i = 0; i < pages_size; i++)
       count += pages[i].size;
 
+    for(const arena_large_page* page = large; page; page = page->next)
+      count += page->size;
+
+    for(const arena_large_page* page = large_free; page; page = page->next)
+      count += page->size;
+
     return count;
   }
 
@@ -198,8 +1353,60 @@ public:
     for(size_t i = 0; i < pages_size; i++)
       count += pages[i].used;
 
+    for(const arena_large_page* page = large; page; page = page->next)
+      count += page->used;
+
     return count;
   }
+
+  // Whether `ptr` points into memory handed out by the arena (the used part
+  // of its pages, or its large pages).
+  bool contains(const void* ptr) const {
+    const char* address = static_cast<const char*>(ptr);
+
+    for(size_t i = 0; i < pages_size; i++) {
+      if(address >= pages[i].buffer && address < pages[i].buffer + pages[i].used)
+        return true;
+    }
+
+    for(const arena_large_page* page = large; page; page = page->next) {
+      const char* buffer = reinterpret_cast<const char*>(page) + large_header_size();
+
+      if(address >= buffer && address < buffer + page->used) return true;
+    }
+
+    return false;
+  }
+
+  // Start of the memory of the arena if it is one contiguous buffer (a
+  // single page, or a reserved arena, and no large pages), otherwise
+  // nullptr. used() bytes from here are in use.
+  const char* data() const {
+    if(pages_size != 1 || large) return nullptr;
+
+    return pages[0].buffer;
+  }
+};
+
+// Rewinds the arena to the position it had at construction when it goes
+// out of scope.
+class arena_scope {
+  arena& _arena;
+  const arena_mark _mark;
+
+public:
+  arena_scope(arena &__arena) : _arena(__arena), _mark(__arena.mark()) { }
+
+  arena_scope(const arena_scope&) = delete;
+  arena_scope& operator=(const arena_scope&) = delete;
+
+  ~arena_scope() {
+    _arena.rewind(_mark);
+  }
+
+  const arena_mark& mark() const {
+    return _mark;
+  }
 };
 
 }
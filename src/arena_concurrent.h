@@ -0,0 +1,316 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#ifndef APC_ARENA_CONCURRENT_MAX_PAGES
+#define APC_ARENA_CONCURRENT_MAX_PAGES 64
+#endif
+
+namespace apc {
+
+struct arena_concurrent_page {
+  size_t size;
+  std::atomic<size_t> used;
+  char* buffer;
+};
+
+// A thread-safe arena. Threads grab large chunks from the shared pages with
+// a single atomic add, and then bump inside their chunk through an
+// `arena_concurrent_local` without any contention.
+// allocate_raw() can also be called directly on the shared arena, which
+// costs one atomic add per allocation.
+// reset() and the destructor must not run concurrently with allocations.
+class arena_concurrent {
+private:
+  std::atomic<arena_concurrent_page*> pages[APC_ARENA_CONCURRENT_MAX_PAGES];
+  std::atomic<size_t> pages_size;
+  std::atomic<size_t> current;
+  std::atomic<size_t> _epoch;
+  size_t _chunk_size;
+  std::mutex grow_mutex;
+
+  static size_t align_up(const size_t size) {
+    const size_t alignment = alignof(std::max_align_t);
+
+    return (size + alignment - 1) & ~(alignment - 1);
+  }
+
+  bool push_page(const size_t size) {
+    const size_t count = pages_size.load(std::memory_order_relaxed);
+
+    if(count == APC_ARENA_CONCURRENT_MAX_PAGES) return false;
+
+    const size_t header_size = align_up(sizeof(arena_concurrent_page));
+    char* memory = static_cast<char*>(malloc(header_size + size));
+
+    if(!memory) return false;
+
+    arena_concurrent_page* page = reinterpret_cast<arena_concurrent_page*>(memory);
+    page->size = size;
+    page->used.store(0, std::memory_order_relaxed);
+    page->buffer = memory + header_size;
+
+    pages[count].store(page, std::memory_order_release);
+    pages_size.store(count + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Called when the page at `index` could not fit `bytes`. Moves `current`
+  // to a page with room, growing if needed. Only one thread grows at a time,
+  // the others find the new page once they get the lock.
+  bool advance(const size_t index, const size_t bytes) {
+    std::lock_guard<std::mutex> lock(grow_mutex);
+
+    if(current.load(std::memory_order_relaxed) != index) return true;
+
+    arena_concurrent_page* page = pages[index].load(std::memory_order_relaxed);
+
+    if(page && page->used.load(std::memory_order_relaxed) + bytes <= page->size)
+      return true;
+
+    const size_t count = pages_size.load(std::memory_order_relaxed);
+
+    for(size_t i = index + 1; i < count; i++) {
+      if(pages[i].load(std::memory_order_relaxed)->size >= bytes) {
+        current.store(i, std::memory_order_release);
+
+        return true;
+      }
+    }
+
+    size_t grow_size = count ?
+      pages[count - 1].load(std::memory_order_relaxed)->size * 2 : _chunk_size;
+
+    if(grow_size < bytes) grow_size = align_up(bytes);
+
+    if(!push_page(grow_size)) return false;
+
+    if(count) current.store(count, std::memory_order_release);
+
+    return true;
+  }
+
+public:
+  arena_concurrent(const size_t size, const size_t chunk_size = 64 * 1024) :
+    pages_size(0),
+    current(0),
+    _epoch(0),
+    _chunk_size(align_up(chunk_size ? chunk_size : 1))
+  {
+    for(size_t i = 0; i < APC_ARENA_CONCURRENT_MAX_PAGES; i++)
+      pages[i].store(nullptr, std::memory_order_relaxed);
+
+    if(size) push_page(align_up(size));
+  }
+
+  arena_concurrent(const arena_concurrent&) = delete;
+  arena_concurrent& operator=(const arena_concurrent&) = delete;
+
+  ~arena_concurrent() {
+    const size_t count = pages_size.load(std::memory_order_acquire);
+
+    for(size_t i = 0; i < count; i++)
+      free(pages[i].load(std::memory_order_relaxed));
+  }
+
+  // Returns `bytes` (rounded up to max_align_t) of max_align_t aligned
+  // memory from the shared pages.
+  void* grab(size_t bytes) {
+    bytes = align_up(bytes);
+
+    for(;;) {
+      const size_t index = current.load(std::memory_order_acquire);
+      arena_concurrent_page* page = pages[index].load(std::memory_order_acquire);
+
+      if(page) {
+        const size_t offset = page->used.fetch_add(bytes, std::memory_order_relaxed);
+
+        if(offset + bytes <= page->size) return page->buffer + offset;
+      }
+
+      if(!advance(index, bytes)) return nullptr;
+    }
+  }
+
+  void* allocate_raw(const size_t size,
+    const size_t alignment = alignof(std::max_align_t)
+  ) {
+    if(!size) return nullptr;
+
+    if(alignment <= alignof(std::max_align_t)) return grab(size);
+
+    char* buffer = static_cast<char*>(grab(size + alignment));
+
+    if(!buffer) return nullptr;
+
+    uintptr_t current_addr = reinterpret_cast<uintptr_t>(buffer);
+    size_t padding = (alignment - (current_addr % alignment)) % alignment;
+
+    return static_cast<void*>(buffer + padding);
+  }
+
+  template <typename T, typename... Args>
+  T* allocate_new(Args&&... args) {
+    T* new_item = allocate_size<T>();
+
+    if(!new_item) return nullptr;
+
+    return new (new_item) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  T* allocate_size(const size_t count = 1) {
+    if(!count) return nullptr;
+
+    return static_cast<T*>(allocate_raw(sizeof(T) * count, alignof(T)));
+  }
+
+  void reset() {
+    const size_t count = pages_size.load(std::memory_order_acquire);
+
+    for(size_t i = 0; i < count; i++)
+      pages[i].load(std::memory_order_relaxed)->used.store(0, std::memory_order_relaxed);
+
+    current.store(0, std::memory_order_release);
+    _epoch.fetch_add(1, std::memory_order_release);
+  }
+
+  size_t epoch() const {
+    return _epoch.load(std::memory_order_relaxed);
+  }
+
+  size_t chunk_size() const {
+    return _chunk_size;
+  }
+
+  size_t size() const {
+    const size_t count = pages_size.load(std::memory_order_acquire);
+    size_t total = 0;
+
+    for(size_t i = 0; i < count; i++)
+      total += pages[i].load(std::memory_order_relaxed)->size;
+
+    return total;
+  }
+
+  // Bytes handed out from the shared pages, including chunks held by
+  // `arena_concurrent_local` that are not yet fully used.
+  size_t used() const {
+    const size_t count = pages_size.load(std::memory_order_acquire);
+    size_t total = 0;
+
+    for(size_t i = 0; i < count; i++) {
+      const arena_concurrent_page* page = pages[i].load(std::memory_order_relaxed);
+      const size_t used = page->used.load(std::memory_order_relaxed);
+
+      total += used < page->size ? used : page->size;
+    }
+
+    return total;
+  }
+};
+
+// Per-thread bump allocator on top of an `arena_concurrent`.
+// Must only be used by a single thread.
+class arena_concurrent_local {
+private:
+  arena_concurrent* shared;
+  char* chunk = nullptr;
+  char* chunk_end = nullptr;
+  size_t epoch = 0;
+
+  void* refill(const size_t size, const size_t alignment) {
+    const size_t chunk_size = shared->chunk_size();
+
+    // Big requests go straight to the shared pages instead of throwing
+    // away most of the current chunk.
+    if(size + alignment > chunk_size / 4)
+      return shared->allocate_raw(size, alignment);
+
+    char* new_chunk = static_cast<char*>(shared->grab(chunk_size));
+
+    if(!new_chunk) return nullptr;
+
+    chunk = new_chunk;
+    chunk_end = new_chunk + chunk_size;
+    epoch = shared->epoch();
+
+    uintptr_t current_addr = reinterpret_cast<uintptr_t>(chunk);
+    size_t padding = (alignment - (current_addr % alignment)) % alignment;
+
+    char* new_allocation = chunk + padding;
+    chunk += padding + size;
+
+    return static_cast<void*>(new_allocation);
+  }
+
+public:
+  arena_concurrent_local(arena_concurrent &__shared) : shared(&__shared) { }
+
+  void* allocate_raw(const size_t size,
+    const size_t alignment = alignof(std::max_align_t)
+  ) {
+    if(!size) return nullptr;
+
+    // A reset() of the shared arena invalidates the chunk.
+    if(epoch == shared->epoch()) {
+      uintptr_t current_addr = reinterpret_cast<uintptr_t>(chunk);
+      size_t padding = (alignment - (current_addr % alignment)) % alignment;
+
+      if(static_cast<size_t>(chunk_end - chunk) >= padding + size) {
+        char* new_allocation = chunk + padding;
+        chunk += padding + size;
+
+        return static_cast<void*>(new_allocation);
+      }
+    }
+
+    return refill(size, alignment);
+  }
+
+  template <typename T, typename... Args>
+  T* allocate_new(Args&&... args) {
+    T* new_item = allocate_size<T>();
+
+    if(!new_item) return nullptr;
+
+    return new (new_item) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  T* allocate_size(const size_t count = 1) {
+    if(!count) return nullptr;
+
+    return static_cast<T*>(allocate_raw(sizeof(T) * count, alignof(T)));
+  }
+
+  // Drop the rest of the current chunk, the next allocation grabs a new one.
+  void release() {
+    chunk = nullptr;
+    chunk_end = nullptr;
+  }
+
+  arena_concurrent& arena() const {
+    return *shared;
+  }
+};
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include "./arena.h"
+
+namespace apc {
+
+// One arena per NUMA node, with the pages of each arena placed on its node.
+// Threads pick the arena of the node they run on with local(), so their
+// allocations stay in local memory.
+// On single-node machines this is a single arena.
+// Like `apc::arena`, each arena must only be used by one thread at a time.
+class arena_numa {
+private:
+  arena* arenas = nullptr;
+  size_t _nodes = 0;
+
+public:
+  // `size` is the initial size of the arena of every node, and `flags` are
+  // combined with page_node() for each of them.
+  arena_numa(const size_t size, const unsigned flags = page_default) {
+    const size_t count = page_numa_nodes();
+
+    arenas = static_cast<arena*>(malloc(sizeof(arena) * count));
+
+    if(!arenas) return;
+
+    for(size_t i = 0; i < count; i++)
+      new (&arenas[i]) arena(size, flags | page_node(static_cast<unsigned>(i)));
+
+    _nodes = count;
+  }
+
+  arena_numa(const arena_numa&) = delete;
+  arena_numa& operator=(const arena_numa&) = delete;
+
+  ~arena_numa() {
+    for(size_t i = 0; i < _nodes; i++)
+      arenas[i].~arena();
+
+    free(arenas);
+  }
+
+  size_t nodes() const {
+    return _nodes;
+  }
+
+  // The arena of `node`. Nodes outside the range wrap around.
+  arena& node(const size_t node) {
+    return arenas[node % _nodes];
+  }
+
+  // The arena of the node the calling thread runs on. Pin the thread to
+  // the node to keep this stable.
+  arena& local() {
+    return node(page_current_node());
+  }
+
+  void reset() {
+    for(size_t i = 0; i < _nodes; i++)
+      arenas[i].reset();
+  }
+
+  size_t size() const {
+    size_t total = 0;
+
+    for(size_t i = 0; i < _nodes; i++)
+      total += arenas[i].size();
+
+    return total;
+  }
+
+  size_t used() const {
+    size_t total = 0;
+
+    for(size_t i = 0; i < _nodes; i++)
+      total += arenas[i].used();
+
+    return total;
+  }
+};
+
+}
@@ -0,0 +1,265 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include "./page.h"
+#include "./offset_ptr.h"
+
+#ifdef APC_PAGE_MMAP
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace apc {
+
+// Stored at the start of the shared region.
+struct arena_shared_header {
+  uint64_t magic;
+  size_t size;
+  std::atomic<size_t> used;
+  // Offset of the root object + 1, 0 if none.
+  std::atomic<size_t> root;
+};
+
+static const uint64_t arena_shared_magic = 0x4150435348415245ULL; // "APCSHARE"
+
+// A fixed size arena in memory shared between processes, backed by
+// memfd_create (for fork()ed children) or shm_open (by name).
+// The bump pointer lives in the shared region and is advanced atomically,
+// so every process can allocate from it at the same time.
+// The region can be mapped at a different address in every process, so
+// use offset_of()/at() or offset_ptr/offset_array to link the data, not
+// raw pointers (which also rules out apc::vector and apc::str, copy their
+// contents into an offset_array instead).
+class arena_shared {
+private:
+  arena_shared_header* header = nullptr;
+  char* buffer = nullptr;
+  size_t map_size = 0;
+  int _fd = -1;
+
+  static size_t header_size() {
+    return (sizeof(arena_shared_header) + 63) & ~static_cast<size_t>(63);
+  }
+
+  // Map `fd`, and set up a new region of `size` bytes if `create`.
+  bool map(const int fd, size_t size, const bool create) {
+    #ifdef APC_PAGE_MMAP
+    if(create) {
+      const size_t os_page = page_os_size();
+
+      size = (header_size() + size + os_page - 1) / os_page * os_page;
+
+      if(ftruncate(fd, size) != 0) return false;
+    } else {
+      struct stat info;
+
+      if(fstat(fd, &info) != 0) return false;
+
+      size = info.st_size;
+
+      if(size < header_size()) return false;
+    }
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if(memory == MAP_FAILED) return false;
+
+    arena_shared_header* new_header = static_cast<arena_shared_header*>(memory);
+
+    if(create) {
+      new (new_header) arena_shared_header();
+      new_header->size = size - header_size();
+      new_header->used.store(0, std::memory_order_relaxed);
+      new_header->root.store(0, std::memory_order_relaxed);
+      new_header->magic = arena_shared_magic;
+    } else if(
+      new_header->magic != arena_shared_magic ||
+      new_header->size != size - header_size()
+    ) {
+      munmap(memory, size);
+
+      return false;
+    }
+
+    header = new_header;
+    buffer = static_cast<char*>(memory) + header_size();
+    map_size = size;
+    _fd = fd;
+
+    return true;
+    #else
+    (void)fd;
+    (void)size;
+    (void)create;
+
+    return false;
+    #endif
+  }
+
+public:
+  // An anonymous shared region of at least `size` bytes. It stays shared
+  // with children created by fork(), and other processes can map it
+  // through fd().
+  explicit arena_shared(const size_t size) {
+    #ifdef APC_PAGE_MMAP
+    int fd = -1;
+
+    #if defined(__linux__) && defined(SYS_memfd_create)
+    fd = static_cast<int>(syscall(SYS_memfd_create, "apc_arena_shared", 0));
+    #endif
+
+    if(fd < 0) return;
+
+    if(!map(fd, size, true)) ::close(fd);
+    #else
+    (void)size;
+    #endif
+  }
+
+  // Create (or replace) the shared memory object `name` (e.g. "/my_arena")
+  // with a region of at least `size` bytes.
+  arena_shared(const char* name, const size_t size) {
+    #ifdef APC_PAGE_MMAP
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+
+    if(fd < 0) return;
+
+    if(!map(fd, size, true)) ::close(fd);
+    #else
+    (void)name;
+    (void)size;
+    #endif
+  }
+
+  // Map the existing shared memory object `name`.
+  explicit arena_shared(const char* name) {
+    #ifdef APC_PAGE_MMAP
+    int fd = shm_open(name, O_RDWR, 0600);
+
+    if(fd < 0) return;
+
+    if(!map(fd, 0, false)) ::close(fd);
+    #else
+    (void)name;
+    #endif
+  }
+
+  arena_shared(const arena_shared&) = delete;
+  arena_shared& operator=(const arena_shared&) = delete;
+
+  ~arena_shared() {
+    #ifdef APC_PAGE_MMAP
+    if(header) munmap(header, map_size);
+    if(_fd >= 0) ::close(_fd);
+    #endif
+  }
+
+  // Remove the shared memory object `name`. Mappings stay valid until they
+  // are unmapped.
+  static bool unlink(const char* name) {
+    #ifdef APC_PAGE_MMAP
+    return shm_unlink(name) == 0;
+    #else
+    (void)name;
+
+    return false;
+    #endif
+  }
+
+  bool valid() const {
+    return header != nullptr;
+  }
+
+  int fd() const {
+    return _fd;
+  }
+
+  void* allocate_raw(const size_t size,
+    const size_t alignment = alignof(std::max_align_t)
+  ) {
+    if(!size || !header) return nullptr;
+
+    size_t used = header->used.load(std::memory_order_relaxed);
+
+    for(;;) {
+      const size_t padding = (0 - reinterpret_cast<uintptr_t>(buffer + used)) & (alignment - 1);
+
+      if(header->size - used < padding + size) return nullptr;
+
+      if(header->used.compare_exchange_weak(used, used + padding + size,
+        std::memory_order_relaxed)
+      ) return buffer + used + padding;
+    }
+  }
+
+  template <typename T, typename... Args>
+  T* allocate_new(Args&&... args) {
+    T* new_item = allocate_size<T>();
+
+    if(!new_item) return nullptr;
+
+    return new (new_item) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  T* allocate_size(const size_t count = 1) {
+    if(!count) return nullptr;
+
+    return static_cast<T*>(allocate_raw(sizeof(T) * count, alignof(T)));
+  }
+
+  // Offset of `ptr` in the region, which means the same in every process.
+  size_t offset_of(const void* ptr) const {
+    return static_cast<const char*>(ptr) - buffer;
+  }
+
+  template <typename T>
+  T* at(const size_t offset) const {
+    return reinterpret_cast<T*>(buffer + offset);
+  }
+
+  // Publish the object other processes start reading from.
+  void set_root(const void* ptr) {
+    header->root.store(ptr ? offset_of(ptr) + 1 : 0, std::memory_order_release);
+  }
+
+  template <typename T>
+  T* root() const {
+    const size_t offset = header ? header->root.load(std::memory_order_acquire) : 0;
+
+    return offset ? at<T>(offset - 1) : nullptr;
+  }
+
+  // Must not run while any process allocates or reads.
+  void reset() {
+    if(!header) return;
+
+    header->root.store(0, std::memory_order_relaxed);
+    header->used.store(0, std::memory_order_release);
+  }
+
+  size_t size() const {
+    return header ? header->size : 0;
+  }
+
+  size_t used() const {
+    return header ? header->used.load(std::memory_order_relaxed) : 0;
+  }
+};
+
+}
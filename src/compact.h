@@ -0,0 +1,206 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include "./arena.h"
+#include "./vector.h"
+#include "./string.h"
+#include "./hashmap.h"
+
+namespace apc {
+
+// Adds up the bytes compact() allocates, in the same order, so the padding
+// between allocations is counted exactly (arena pages start aligned to
+// max_align_t).
+struct compact_counter {
+  size_t used = 0;
+
+  void add(const size_t size, const size_t alignment) {
+    if(!size) return;
+
+    if(alignment > alignof(std::max_align_t)) {
+      // Where an over-aligned allocation lands depends on the address of
+      // the page, count the worst case.
+      used += alignment - 1 + size;
+
+      return;
+    }
+
+    used = (used + alignment - 1) & ~(alignment - 1);
+    used += size;
+  }
+};
+
+// How compact() copies a `T`. The default uses the copy constructor, which
+// is right for types that do not own memory. Specialize it (with `deep`,
+// `size()` and `copy()` like the containers below) for types holding apc
+// containers, so their contents are copied into the arena as well.
+// `copy()` returns false when the arena ran out of room.
+template <typename T>
+struct compact_traits {
+  static const bool deep = false;
+
+  static void size(compact_counter&, const T&) { }
+
+  static bool copy(apc::arena&, T* dst, const T& src) {
+    new (dst) T(src);
+
+    return true;
+  }
+};
+
+// Construct a copy of `src` at `dst`, with everything it owns in `arena`.
+template <typename T>
+bool compact_copy(apc::arena &arena, T* dst, const T& src) {
+  return compact_traits<T>::copy(arena, dst, src);
+}
+
+template <typename T>
+void compact_size(compact_counter &counter, const T& src) {
+  compact_traits<T>::size(counter, src);
+}
+
+template <typename T, bool FORCE_TRIVIAL_COPY>
+struct compact_traits<apc::vector<T, FORCE_TRIVIAL_COPY>> {
+  typedef apc::vector<T, FORCE_TRIVIAL_COPY> type;
+
+  static const bool deep = true;
+
+  static bool push(apc::arena&, type* dst, const T& item, std::false_type) {
+    return dst->push(item) != nullptr;
+  }
+
+  // Take the slot with a default constructed item (which owns no memory),
+  // and copy over it.
+  static bool push(apc::arena &arena, type* dst, const T& item, std::true_type) {
+    T* slot = dst->push_new();
+
+    if(!slot) return false;
+
+    slot->~T();
+
+    return compact_copy(arena, slot, item);
+  }
+
+  static void size(compact_counter &counter, const type &src) {
+    counter.add(sizeof(T) * src.used(), alignof(T));
+
+    for(size_t i = 0; i < src.used(); i++) compact_size(counter, src[i]);
+  }
+
+  static bool copy(apc::arena &arena, type* dst, const type &src) {
+    new (dst) type(arena, src.used());
+    dst->growth(src.growth());
+
+    for(size_t i = 0; i < src.used(); i++) {
+      if(!push(arena, dst, src[i], std::integral_constant<bool, compact_traits<T>::deep>()))
+        return false;
+    }
+
+    return true;
+  }
+};
+
+template <size_t N>
+struct compact_traits<apc::str_dynamic<N>> {
+  typedef apc::str_dynamic<N> type;
+
+  static const bool deep = true;
+
+  // Strings that fit the static buffer need no allocation.
+  static void size(compact_counter &counter, const type &src) {
+    if(src.used() > N) counter.add(src.used() + 1, 1);
+  }
+
+  static bool copy(apc::arena &arena, type* dst, const type &src) {
+    new (dst) type(arena, src.c_str(), src.used());
+
+    return dst->used() == src.used();
+  }
+};
+
+template <typename T, size_t S, bool FORCE_TRIVIAL_COPY>
+struct compact_traits<apc::hashmap<T, S, FORCE_TRIVIAL_COPY>> {
+  typedef apc::hashmap<T, S, FORCE_TRIVIAL_COPY> type;
+
+  static const bool deep = true;
+
+  // Mirrors hashmap::init(arena, buckets, items): the bucket array, then
+  // the pool page and its page list.
+  static void size(compact_counter &counter, const type &src) {
+    if(!src.size()) return;
+
+    counter.add(sizeof(hashmap_item<T, S>*) * src.size(), alignof(hashmap_item<T, S>*));
+
+    if(src.items()) {
+      counter.add(sizeof(pool_item<hashmap_item<T, S>>) * src.items(),
+        alignof(pool_item<hashmap_item<T, S>>));
+      counter.add(sizeof(pool_page<hashmap_item<T, S>>),
+        alignof(pool_page<hashmap_item<T, S>>));
+    }
+
+    src.for_each([&counter](const void*, const T &value) {
+      compact_size(counter, value);
+    });
+  }
+
+  // Same number of buckets, so the items land in the same buckets and the
+  // copy does not grow.
+  static bool copy(apc::arena &arena, type* dst, const type &src) {
+    new (dst) type(arena, 0);
+    dst->init(arena, src.size(), src.items());
+
+    bool copied = dst->size() == src.size();
+
+    src.for_each([&arena, dst, &copied](const void* key, const T &value) {
+      if(!copied) return;
+
+      T* item = dst->insert_raw(const_cast<void*>(key));
+
+      copied = item && compact_copy(arena, item, value);
+    });
+
+    return copied;
+  }
+};
+
+// Bytes an arena needs to hold compact(arena, root): the root and
+// everything it owns, including the padding in between.
+template <typename T>
+size_t compact_size(const T& root) {
+  compact_counter counter;
+
+  counter.add(sizeof(T), alignof(T));
+  compact_size(counter, root);
+
+  return counter.used;
+}
+
+// Deep copy `root` and the vectors, strs and hashmaps it holds into
+// `arena`. With an arena of compact_size(root) bytes everything ends up
+// packed in one page, and the arena(s) of `root` can be dropped.
+// The copy lives in the arena and is not destroyed with it, which is fine
+// as long as everything it owns is in the arena too.
+// Returns nullptr if the arena ran out of room part way.
+template <typename T>
+T* compact(apc::arena &arena, const T& root) {
+  T* copy = arena.allocate_size<T>();
+
+  if(!copy || !compact_copy(arena, copy, root)) return nullptr;
+
+  return copy;
+}
+
+}
@@ -0,0 +1,166 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "./arena.h"
+
+namespace apc {
+
+struct frame_generation_stats {
+  size_t generation;
+  // Bytes in use, for a retired generation when it was reset.
+  size_t used;
+  // Bytes held by the arena of the generation.
+  size_t size;
+};
+
+// A ring of K arenas for pipelines where the allocations of a frame must
+// live for K frames. Allocations go to the arena of the current
+// generation, and advance() moves on to the next one, resetting the arena
+// of the generation that is K frames old.
+// E.g. with frame_arena<3>, data from frame N is valid until frame N + 2.
+template <size_t K>
+class frame_arena {
+  static_assert(K >= 2, "A frame_arena needs at least two generations");
+
+private:
+  alignas(arena) unsigned char storage[K][sizeof(arena)];
+  size_t _generation = 0;
+  size_t _high_water = 0;
+  frame_generation_stats _retired = { 0, 0, 0 };
+
+  arena& slot(const size_t generation) {
+    return *reinterpret_cast<arena*>(storage[generation % K]);
+  }
+
+  const arena& slot(const size_t generation) const {
+    return *reinterpret_cast<const arena*>(storage[generation % K]);
+  }
+
+  bool live(const size_t generation) const {
+    return generation <= _generation && _generation - generation < K;
+  }
+
+public:
+  // `size` is the initial size of each of the K arenas.
+  frame_arena(const size_t size, const unsigned flags = page_default) {
+    for(size_t i = 0; i < K; i++)
+      new (storage[i]) arena(size, flags);
+  }
+
+  frame_arena(const frame_arena&) = delete;
+  frame_arena& operator=(const frame_arena&) = delete;
+
+  ~frame_arena() {
+    for(size_t i = 0; i < K; i++)
+      reinterpret_cast<arena*>(storage[i])->~arena();
+  }
+
+  // Start the next frame. The generation that was K - 1 frames before the
+  // current one is reset, and its memory reused.
+  void advance() {
+    const size_t used = current().used();
+
+    if(used > _high_water) _high_water = used;
+
+    _generation++;
+
+    if(_generation >= K) {
+      arena &oldest = slot(_generation);
+
+      _retired = { _generation - K, oldest.used(), oldest.size() };
+      oldest.reset();
+    }
+  }
+
+  size_t generation() const {
+    return _generation;
+  }
+
+  arena& current() {
+    return slot(_generation);
+  }
+
+  // The arena of a live `generation`, or nullptr if it was reset.
+  arena* get(const size_t generation) {
+    return live(generation) ? &slot(generation) : nullptr;
+  }
+
+  // The live generation `ptr` was allocated in, or -1 if it is not in any
+  // of them.
+  long generation_of(const void* ptr) const {
+    for(size_t i = 0; i < K && i <= _generation; i++) {
+      if(slot(_generation - i).contains(ptr))
+        return static_cast<long>(_generation - i);
+    }
+
+    return -1;
+  }
+
+  // Stats of a live generation. `generation` must be live.
+  frame_generation_stats stats(const size_t generation) const {
+    const arena &generation_arena = slot(generation);
+
+    return { generation, generation_arena.used(), generation_arena.size() };
+  }
+
+  // Stats of the last generation that was reset.
+  const frame_generation_stats& retired() const {
+    return _retired;
+  }
+
+  // The most bytes used by a single generation.
+  size_t high_water() const {
+    const size_t used = slot(_generation).used();
+
+    return used > _high_water ? used : _high_water;
+  }
+
+  void* allocate_raw(const size_t size,
+    const size_t alignment = alignof(std::max_align_t)
+  ) {
+    return current().allocate_raw(size, alignment);
+  }
+
+  template <typename T, typename... Args>
+  T* allocate_new(Args&&... args) {
+    return current().template allocate_new<T>(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  T* allocate_size(const size_t count = 1) {
+    return current().template allocate_size<T>(count);
+  }
+
+  size_t size() const {
+    size_t total = 0;
+
+    for(size_t i = 0; i < K; i++)
+      total += slot(i).size();
+
+    return total;
+  }
+
+  size_t used() const {
+    size_t total = 0;
+
+    for(size_t i = 0; i < K; i++)
+      total += slot(i).used();
+
+    return total;
+  }
+};
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace apc {
+
+// How `arena`, `pool` and `vector` grow when they run out of room.
+// Sizes are in bytes, and apply to the total size of the container.
+// A default constructed policy keeps the built-in doubling of each
+// container, but can still have a limit().
+struct growth_policy {
+  // Grow the total size by factor / divisor (0 for the built-in growth).
+  size_t factor;
+  size_t divisor;
+  // Grow by at least `min_step`, and at most `max_step` (0 for no cap).
+  size_t min_step;
+  size_t max_step;
+  // Never grow past `max_size` in total (0 for no limit).
+  size_t max_size;
+
+  growth_policy() :
+    factor(0), divisor(1), min_step(0), max_step(0), max_size(0) { }
+
+  // E.g. geometric(3, 2) grows by 1.5x.
+  static growth_policy geometric(const size_t factor, const size_t divisor = 1) {
+    growth_policy policy;
+    policy.factor = factor;
+    policy.divisor = divisor ? divisor : 1;
+
+    return policy;
+  }
+
+  // Grow by `step` bytes every time.
+  static growth_policy fixed(const size_t step) {
+    growth_policy policy = geometric(1);
+    policy.min_step = step;
+    policy.max_step = step;
+
+    return policy;
+  }
+
+  // Geometric growth, but never more than `max_step` bytes at once.
+  static growth_policy capped(const size_t max_step, const size_t factor = 2,
+    const size_t divisor = 1
+  ) {
+    growth_policy policy = geometric(factor, divisor);
+    policy.max_step = max_step;
+
+    return policy;
+  }
+
+  // A copy of this policy that never grows past `max_size` bytes in total.
+  growth_policy limit(const size_t max_size) const {
+    growth_policy policy = *this;
+    policy.max_size = max_size;
+
+    return policy;
+  }
+
+  // The new total size for a container of `total` bytes that needs at least
+  // `needed` bytes in total. `builtin` is what the container would grow to
+  // by itself. Returns 0 if `needed` does not fit under max_size.
+  size_t next(const size_t total, const size_t needed, const size_t builtin) const {
+    size_t size = builtin;
+
+    if(factor) {
+      size = (total / divisor * factor) + (total % divisor * factor / divisor);
+
+      if(size < total + min_step) size = total + min_step;
+      if(max_step && size > total + max_step) size = total + max_step;
+    }
+
+    if(size < needed) size = needed;
+
+    if(max_size && size > max_size) size = max_size;
+
+    return size >= needed ? size : 0;
+  }
+};
+
+}
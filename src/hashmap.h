@@ -46,9 +46,19 @@ struct hashmap_item {
   \
   public: \
   \
-  size_t size() { return array.size(); } \
+  size_t size() const { return array.size(); } \
   \
-  size_t used() { return _used; } \
+  size_t used() const { return _used; } \
+  \
+  /* Number of items, used() counts the buckets in use. */ \
+  size_t items() const { return pool.used(); } \
+  \
+  /* Call `f(key, value)` for every item. */ \
+  template <typename F> \
+  void for_each(F f) const { \
+    for(auto* item = pool.used_ptr(); item != nullptr; item = item->next) \
+      f(static_cast<const void*>(item->value.key), item->value.current); \
+  } \
   \
   void reset() { \
     _reset(true); \
@@ -201,15 +211,40 @@ public:
   }
 
   void init(apc::arena& arena, size_t _size = 16) {
+    init(arena, _size, _size);
+  }
+
+  // Like init(), with room for `items` items instead of one per bucket.
+  void init(apc::arena& arena, size_t _size, size_t items) {
     // If requested size is 0, or already initialized, return.
     if(!_size || size()) return;
 
     array.init(arena, _size);
-    pool.init(arena, _size);
+    pool.init(arena, items);
     _reset();
   }
   #endif
 
+  // Add `key` and return the uninitialized storage for its value, which
+  // the caller must construct (e.g. with placement new).
+  // Returns nullptr if the key already exists, or allocation fails.
+  T* insert_raw(void* key) {
+    if(!size()) init();
+    if(!size() || find(key)) return nullptr;
+
+    uint64_t hash = rapidhashNano(key, S);
+    size_t index = hash % (size() - 1);
+
+    apc::hashmap_item<T, S>* n = pool.allocate_raw();
+
+    if(n == nullptr) return nullptr;
+
+    memcpy(n->key, key, S);
+    link(n, &array[index]);
+
+    return &n->current;
+  }
+
   bool insert(T& item, void* key) {
     if(!size()) init();
     if(!size()) return false;
@@ -248,6 +283,15 @@ public:
     else
       new (&n->current) T(item);
 
+    link(n, location);
+
+    return true;
+  }
+
+private:
+  // Put `n` at the head of the bucket at `location`, and grow the buckets
+  // once 75% are in use.
+  void link(apc::hashmap_item<T, S>* n, apc::hashmap_item<T, S>** location) {
     n->next = *location;
 
     *location = n;
@@ -283,8 +327,6 @@ public:
         }
       }
     }
-
-    return true;
   }
 };
 
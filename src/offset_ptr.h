@@ -0,0 +1,135 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string.h>
+
+namespace apc {
+
+// A pointer that stores the distance from itself to the target instead of
+// an address, so structures built with it keep working when the memory
+// they live in is mapped at another address.
+// Only point to memory in the same arena. An offset of 1 means nullptr.
+template <typename T>
+class offset_ptr {
+private:
+  intptr_t offset = 1;
+
+  void set(const T* ptr) {
+    offset = ptr ?
+      reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this) : 1;
+  }
+
+public:
+  offset_ptr() { }
+
+  offset_ptr(T* ptr) {
+    set(ptr);
+  }
+
+  // The offset depends on where the pointer is, so copies are recomputed.
+  offset_ptr(const offset_ptr &other) {
+    set(other.get());
+  }
+
+  offset_ptr& operator=(const offset_ptr &other) {
+    set(other.get());
+
+    return *this;
+  }
+
+  offset_ptr& operator=(T* ptr) {
+    set(ptr);
+
+    return *this;
+  }
+
+  T* get() const {
+    if(offset == 1) return nullptr;
+
+    return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + offset);
+  }
+
+  T* operator->() const {
+    return get();
+  }
+
+  T& operator*() const {
+    return *get();
+  }
+
+  T& operator[](const size_t i) const {
+    return get()[i];
+  }
+
+  explicit operator bool() const {
+    return offset != 1;
+  }
+};
+
+// A relocatable array (or string, with T = char) made of an offset_ptr and
+// a size.
+template <typename T>
+class offset_array {
+private:
+  offset_ptr<T> _data;
+  size_t _size = 0;
+
+public:
+  offset_array() { }
+
+  offset_array(T* data, const size_t size) : _data(data), _size(size) { }
+
+  void assign(T* data, const size_t size) {
+    _data = data;
+    _size = size;
+  }
+
+  // Allocate `size` items in `arena` (an `apc::arena`, `apc::arena_shared`
+  // or anything else with allocate_size<T>()) and copy `source` into them.
+  template <typename A>
+  bool assign(A &arena, const T* source, const size_t size) {
+    T* data = arena.template allocate_size<T>(size);
+
+    if(size && !data) return false;
+
+    if(size) memcpy(data, source, sizeof(T) * size);
+
+    assign(data, size);
+
+    return true;
+  }
+
+  T* data() const {
+    return _data.get();
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  T& operator[](const size_t i) const {
+    return _data[i];
+  }
+
+  T* begin() const {
+    return _data.get();
+  }
+
+  T* end() const {
+    return _data.get() + _size;
+  }
+};
+
+}
@@ -0,0 +1,269 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define APC_PAGE_MMAP 1
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Highest NUMA node count page_bind() can handle.
+#ifndef APC_PAGE_NUMA_MAX_NODES
+#define APC_PAGE_NUMA_MAX_NODES 64
+#endif
+
+namespace apc {
+
+// Flags for how the arena and pool allocate their pages.
+// With `page_default` pages are plain malloc/free.
+enum page_flags : unsigned {
+  page_default = 0,
+  // Back pages with 2 MiB huge pages. Tries MAP_HUGETLB first, then falls
+  // back to transparent huge pages with madvise(MADV_HUGEPAGE).
+  page_huge = 1 << 0,
+  // Fault the memory in when the page is allocated, so the first use does
+  // not take page faults.
+  page_prefault = 1 << 1,
+  // Place the pages on a NUMA node, use page_node() to set the node.
+  page_numa = 1 << 2,
+};
+
+// Flags for placing pages on NUMA `node`, e.g.
+// `apc::arena arena(size, apc::page_node(1) | apc::page_prefault)`.
+// On machines (or kernels) without NUMA this is the same as plain mmap'ed
+// pages.
+inline unsigned page_node(const unsigned node) {
+  return page_numa | (node << 8);
+}
+
+// The NUMA node in `flags`, or -1 if none.
+inline int page_flags_node(const unsigned flags) {
+  return (flags & page_numa) ? static_cast<int>(flags >> 8) : -1;
+}
+
+static const size_t page_huge_size = 2 * 1024 * 1024;
+
+inline size_t page_os_size() {
+  #ifdef APC_PAGE_MMAP
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+  return size;
+  #else
+  return 4096;
+  #endif
+}
+
+// The size that will actually be allocated for a `size` byte page.
+inline size_t page_round(const size_t size, const unsigned flags) {
+  #ifdef APC_PAGE_MMAP
+  if(flags) {
+    const size_t unit = (flags & page_huge) ? page_huge_size : page_os_size();
+
+    return (size + unit - 1) / unit * unit;
+  }
+  #endif
+
+  (void)flags;
+
+  return size;
+}
+
+// Touch every OS page in the range so it is backed by memory.
+inline void page_touch(void* ptr, const size_t size) {
+  if(!ptr || !size) return;
+
+  #if defined(APC_PAGE_MMAP) && defined(MADV_POPULATE_WRITE)
+  if(madvise(ptr, size, MADV_POPULATE_WRITE) == 0) return;
+  #endif
+
+  volatile char* buffer = static_cast<volatile char*>(ptr);
+  const size_t step = page_os_size();
+
+  for(size_t i = 0; i < size; i += step)
+    buffer[i] = buffer[i];
+
+  buffer[size - 1] = buffer[size - 1];
+}
+
+// Number of NUMA nodes on the machine, 1 if unknown.
+inline size_t page_numa_nodes() {
+  static const size_t nodes = []() {
+    size_t count = 1;
+
+    #ifdef __linux__
+    FILE* file = fopen("/sys/devices/system/node/online", "r");
+
+    if(file) {
+      // A list of ranges like "0-1,3".
+      unsigned first = 0, last = 0;
+      char separator = 0;
+
+      while(fscanf(file, "%u", &first) == 1) {
+        last = first;
+
+        if(fscanf(file, "%c", &separator) == 1 && separator == '-')
+          if(fscanf(file, "%u%c", &last, &separator) < 1) break;
+
+        if(last + 1 > count) count = last + 1;
+
+        if(separator != ',') break;
+      }
+
+      fclose(file);
+    }
+    #endif
+
+    return count;
+  }();
+
+  return nodes;
+}
+
+// The NUMA node of the CPU the calling thread runs on, 0 if unknown.
+inline size_t page_current_node() {
+  #if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu = 0, node = 0;
+
+  if(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node;
+  #endif
+
+  return 0;
+}
+
+// Prefer NUMA `node` for the OS pages in the range (which must be page
+// aligned). Only affects memory that has not been touched yet. Returns
+// false where NUMA is not supported, and the memory is then left as is.
+inline bool page_bind(void* ptr, const size_t size, const int node) {
+  #if defined(__linux__) && defined(SYS_mbind)
+  const size_t bits = sizeof(unsigned long) * 8;
+
+  if(!ptr || node < 0 || static_cast<size_t>(node) >= APC_PAGE_NUMA_MAX_NODES)
+    return false;
+
+  unsigned long mask[(APC_PAGE_NUMA_MAX_NODES + bits - 1) / bits] = {};
+  mask[node / bits] = 1UL << (node % bits);
+
+  // 1 is MPOL_PREFERRED, pages fall back to other nodes when it is full.
+  return syscall(SYS_mbind, ptr, size, 1, mask, APC_PAGE_NUMA_MAX_NODES + 1, 0) == 0;
+  #else
+  (void)ptr;
+  (void)size;
+  (void)node;
+
+  return false;
+  #endif
+}
+
+// `alignment` (a power of two) is only used for malloc'ed pages, mmap'ed
+// pages are always aligned to the OS page size.
+inline void* page_allocate(const size_t size, const unsigned flags,
+  const size_t alignment = 0
+) {
+  if(!size) return nullptr;
+
+  #ifdef APC_PAGE_MMAP
+  if(flags) {
+    const size_t rounded = page_round(size, flags);
+    const int node = page_flags_node(flags);
+    void* ptr = MAP_FAILED;
+    bool populated = false;
+
+    // NUMA pages must be bound before they are touched, so they are
+    // prefaulted after the mbind instead of with MAP_POPULATE.
+    #ifdef MAP_HUGETLB
+    if(flags & page_huge) {
+      int map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+
+      if((flags & page_prefault) && node < 0) {
+        map_flags |= MAP_POPULATE;
+        populated = true;
+      }
+
+      ptr = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+
+      if(ptr == MAP_FAILED) populated = false;
+    }
+    #endif
+
+    if(ptr == MAP_FAILED) {
+      // Transparent huge pages must also be advised before the memory is
+      // touched.
+      int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+      #ifdef MAP_POPULATE
+      if((flags & page_prefault) && !(flags & page_huge) && node < 0) {
+        map_flags |= MAP_POPULATE;
+        populated = true;
+      }
+      #endif
+
+      ptr = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+
+      if(ptr == MAP_FAILED) return nullptr;
+
+      #ifdef MADV_HUGEPAGE
+      if(flags & page_huge) madvise(ptr, rounded, MADV_HUGEPAGE);
+      #endif
+    }
+
+    if(node >= 0) page_bind(ptr, rounded, node);
+
+    if((flags & page_prefault) && !populated) page_touch(ptr, rounded);
+
+    return ptr;
+  }
+  #endif
+
+  void* ptr = nullptr;
+
+  #ifdef APC_PAGE_MMAP
+  if(alignment > alignof(std::max_align_t)) {
+    if(posix_memalign(&ptr, alignment, size) != 0) ptr = nullptr;
+  } else
+    ptr = malloc(size);
+  #else
+  (void)alignment;
+
+  ptr = malloc(size);
+  #endif
+
+  if(ptr && (flags & page_prefault)) page_touch(ptr, size);
+
+  return ptr;
+}
+
+inline void page_free(void* ptr, const size_t size, const unsigned flags) {
+  if(!ptr) return;
+
+  #ifdef APC_PAGE_MMAP
+  if(flags) {
+    munmap(ptr, page_round(size, flags));
+
+    return;
+  }
+  #endif
+
+  (void)size;
+
+  free(ptr);
+}
+
+}
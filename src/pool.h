@@ -11,9 +11,17 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstddef>
+#include <cstdint>
+#include <new>
 #include <type_traits>
+#include <utility>
+#include <string.h>
+#include "./page.h"
+#include "./growth.h"
+#include "./trace.h"
 
 #ifdef ARENA_POOL_CPP
 #include "./arena.h"
@@ -43,9 +51,34 @@ struct pool_page_fixed {
 
 #define POOL_CLASS_COMMON \
   private: \
+    /* Items given back with deallocate(). */ \
     pool_item<T>* free_ptr = nullptr; \
     pool_item<T>* use_ptr = nullptr; \
     size_t _used = 0; \
+    /* Items from `bump_index` in page `bump_page` onwards have not been */ \
+    /* used since the last reset, and are handed out in order. */ \
+    size_t bump_page = 0; \
+    size_t bump_index = 0; \
+    \
+    /* A recycled item, else the next item never used. */ \
+    pool_item<T>* next_free() { \
+      if(free_ptr) { \
+        pool_item<T>* item = free_ptr; \
+        free_ptr = free_ptr->next; \
+        \
+        return item; \
+      } \
+      \
+      while(bump_page < pages_size) { \
+        if(bump_index < pages[bump_page].size) \
+          return &(pages[bump_page].buffer[bump_index++]); \
+        \
+        bump_page++; \
+        bump_index = 0; \
+      } \
+      \
+      return nullptr; \
+    } \
     \
   public: \
     size_t size() const { \
@@ -62,9 +95,9 @@ struct pool_page_fixed {
       return _used; \
     } \
     \
+    /* O(1) for trivially destructible T: the items are not relinked, */ \
+    /* allocation just starts over from the first item. */ \
     void reset() { \
-      if(!pages_size) return; \
-      \
       if(!std::is_trivially_destructible<T>::value) { \
         while(use_ptr) { \
           use_ptr->value.~T(); \
@@ -72,20 +105,10 @@ struct pool_page_fixed {
         } \
       } \
       \
-      pool_item<T>* previous = nullptr; \
-      for(size_t i = 0; i < pages_size; i++) { \
-        for(size_t z = 0; z < pages[i].size; z++) { \
-          if(previous != nullptr) previous->next = &(pages[i].buffer[z]); \
-          \
-          previous = &(pages[i].buffer[z]); \
-          previous->prev = nullptr; \
-          previous->next = nullptr; \
-        } \
-      } \
-      \
-      previous->next = nullptr; \
-      free_ptr = &(pages[0].buffer[0]); \
-      \
+      use_ptr = nullptr; \
+      free_ptr = nullptr; \
+      bump_page = 0; \
+      bump_index = 0; \
       _used = 0; \
     } \
     \
@@ -130,6 +153,8 @@ struct pool_page_fixed {
       /* it is nullptr. */ \
       if(use_ptr != item && item->prev == nullptr) return; \
       \
+      APC_TRACE_EVENT(trace_pool_deallocate, this, ptr, sizeof(T)); \
+      \
       if(!std::is_trivially_destructible<T>::value && !FORCE_TRIVIAL_COPY) item->value.~T(); \
       \
       if(item->prev) item->prev->next = item->next; \
@@ -144,26 +169,57 @@ struct pool_page_fixed {
     } \
     pool_item<T>* used_ptr() { \
       return use_ptr; \
+    } \
+    \
+    const pool_item<T>* used_ptr() const { \
+      return use_ptr; \
     }
 
 template <typename T, bool FORCE_TRIVIAL_COPY = false>
 class pool {
 private:
   #ifdef ARENA_POOL_CPP
-  arena* arena = nullptr;
+  apc::arena* arena = nullptr;
   #endif
 
   pool_page<T>* pages = nullptr;
   size_t pages_size = 0;
+  unsigned _flags = page_default;
+  growth_policy _growth;
+  size_t _warm_ahead = 0;
+  // Items in all pages, so allocate_raw() need not add up the pages.
+  size_t _capacity = 0;
+  // Growing ahead failed, do not try again on every allocation until a
+  // page was added or the growth policy changed.
+  bool _warm_failed = false;
+
+  // Add a page of at least `count` items, sized by the growth policy.
+  bool grow_next(const size_t count) {
+    // The built-in growth adds a page of twice the current size.
+    const size_t item = sizeof(pool_item<T>);
+    const size_t total = _capacity * item;
+    const size_t next = _growth.next(total, total + item * count,
+      total + (_capacity ? _capacity * 2 : 1) * item);
+
+    return next && grow((next - total) / item);
+  }
+
+  // New pages are not touched by grow(), fault in the last one ahead of use.
+  bool touch_last_page() {
+    page_touch(pages[pages_size - 1].buffer, sizeof(pool_item<T>) * pages[pages_size - 1].size);
+
+    return true;
+  }
 
 public:
   T* allocate_raw() {
-    if(!free_ptr) {
-      if(!grow(size() ? size() * 2 : 1)) return nullptr;
-    }
+    pool_item<T>* chunk = next_free();
+
+    if(!chunk) {
+      if(!grow_next(1)) return nullptr;
 
-    pool_item<T>* chunk = free_ptr;
-    free_ptr = free_ptr->next;
+      chunk = next_free();
+    }
 
     if(use_ptr) use_ptr->prev = chunk;
 
@@ -172,6 +228,13 @@ public:
     use_ptr = chunk;
     _used++;
 
+    if(_warm_ahead && !_warm_failed && _capacity - _used < _warm_ahead) {
+      if(grow_next(1)) touch_last_page();
+      else _warm_failed = true;
+    }
+
+    APC_TRACE_EVENT(trace_pool_allocate, this, &chunk->value, sizeof(T), alignof(T));
+
     return &chunk->value;
   }
 
@@ -184,7 +247,10 @@ public:
   }
   #endif
 
-  pool(const size_t pool_size = 0) {
+  // `flags` is a combination of `page_flags`, and controls how the pages
+  // of the pool are allocated (huge pages, prefaulting).
+  // Pools in an arena use the pages of the arena instead.
+  pool(const size_t pool_size = 0, const unsigned flags = page_default) : _flags(flags) {
     if(pool_size) grow(pool_size);
   }
 
@@ -200,7 +266,7 @@ public:
     if(!arena) {
     #endif
       for(size_t i = 0; i < pages_size; i++) {
-        free(pages[i].buffer);
+        page_free(pages[i].buffer, sizeof(pool_item<T>) * pages[i].size, _flags);
       }
 
       free(pages);
@@ -221,6 +287,50 @@ public:
   }
   #endif
 
+  unsigned flags() const {
+    return _flags;
+  }
+
+  // Touch the memory of all pages, so the first use of the items does not
+  // take page faults.
+  void prefault() {
+    for(size_t i = 0; i < pages_size; i++)
+      page_touch(pages[i].buffer, sizeof(pool_item<T>) * pages[i].size);
+  }
+
+  // Make sure `count` more items can be allocated without growing, and
+  // fault in the new page.
+  bool warm(const size_t count) {
+    const size_t available = _capacity - _used;
+
+    if(available >= count) return true;
+
+    return grow_next(count - available) && touch_last_page();
+  }
+
+  // Once fewer than `count` items are free, grow the next page during the
+  // allocation that crossed the mark, instead of when the pool is empty.
+  // 0 (the default) disables it.
+  void warm_ahead(const size_t count) {
+    _warm_ahead = count;
+    _warm_failed = false;
+  }
+
+  size_t warm_ahead() const {
+    return _warm_ahead;
+  }
+
+  // How new pages are sized when the pool runs out of free items, see
+  // `growth_policy`.
+  void growth(const growth_policy &policy) {
+    _growth = policy;
+    _warm_failed = false;
+  }
+
+  const growth_policy& growth() const {
+    return _growth;
+  }
+
   bool grow(const size_t size) {
     pool_item<T>* new_buffer = nullptr;
     size_t new_count = pages_size + 1;
@@ -230,7 +340,7 @@ public:
       new_buffer = arena->allocate_size<pool_item<T>>(size);
     else
     #endif
-      new_buffer = static_cast<pool_item<T>*>(malloc(sizeof(pool_item<T>) * size));
+      new_buffer = static_cast<pool_item<T>*>(page_allocate(sizeof(pool_item<T>) * size, _flags));
 
     if(!new_buffer) return false;
 
@@ -254,7 +364,7 @@ public:
       #ifdef ARENA_POOL_CPP
       if(!arena)
       #endif
-        free(new_buffer);
+        page_free(new_buffer, sizeof(pool_item<T>) * size, _flags);
 
       return false;
     }
@@ -264,16 +374,12 @@ public:
       memcpy(new_list, pages, sizeof(pool_page<T>) * pages_size);
     #endif
 
+    // The items are not touched until they are handed out.
     new_list[new_count - 1] = { new_buffer, size };
     pages = new_list;
     pages_size = new_count;
-
-    for(size_t i = 1; i < size; i++) {
-      new_buffer[i - 1].next = &(new_buffer[i]);
-    }
-    
-    new_buffer[size - 1].next = free_ptr;
-    free_ptr = &(new_buffer[0]);
+    _capacity += size;
+    _warm_failed = false;
 
     return true;
   }
@@ -287,10 +393,9 @@ private:
 
 public:
   T* allocate_raw() {
-    if(!free_ptr) return nullptr;
+    pool_item<T>* chunk = next_free();
 
-    pool_item<T>* chunk = free_ptr;
-    free_ptr = free_ptr->next;
+    if(!chunk) return nullptr;
 
     if(use_ptr) use_ptr->prev = chunk;
 
@@ -299,6 +404,8 @@ public:
     use_ptr = chunk;
     _used++;
 
+    APC_TRACE_EVENT(trace_pool_allocate, this, &chunk->value, sizeof(T), alignof(T));
+
     return &chunk->value;
   }
 
@@ -319,4 +426,357 @@ public:
   }
 };
 
+
+// An item of a pool_compact: the free-list link overlaps the value.
+template <typename T>
+union pool_compact_item {
+  pool_compact_item* next;
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+};
+
+template <typename T>
+struct pool_compact_page {
+  pool_compact_item<T>* buffer;
+  // One bit per item, only for non-trivially destructible T.
+  uint64_t* occupied;
+  size_t size;
+};
+
+// A pool without the prev/next pointers of `apc::pool`: a free item holds
+// the free-list link in place of the value, so an item is only
+// max(sizeof(T), sizeof(void*)) bytes, and allocate_raw()/deallocate()
+// touch nothing but the item itself.
+// Items in use are not linked anywhere. When T is not trivially
+// destructible every page carries an occupancy bitmap, which reset() and
+// the destructor fill in from the free list to find the items to destroy.
+// Unlike `apc::pool`, deallocating a pointer twice is not detected.
+template <typename T, bool FORCE_TRIVIAL_COPY = false>
+class pool_compact {
+private:
+  #ifdef ARENA_POOL_CPP
+  apc::arena* arena = nullptr;
+  #endif
+
+  // Items given back with deallocate().
+  pool_compact_item<T>* free_ptr = nullptr;
+  pool_compact_page<T>* pages = nullptr;
+  size_t pages_size = 0;
+  size_t _used = 0;
+  // Items from `bump_index` in page `bump_page` onwards have not been used
+  // since the last reset, and are handed out in order.
+  size_t bump_page = 0;
+  size_t bump_index = 0;
+  unsigned _flags = page_default;
+  growth_policy _growth;
+
+  static const bool destroy = !std::is_trivially_destructible<T>::value && !FORCE_TRIVIAL_COPY;
+
+  static size_t bitmap_words(const size_t size) {
+    return destroy ? (size + 63) / 64 : 0;
+  }
+
+  static size_t page_bytes(const size_t size) {
+    return sizeof(pool_compact_item<T>) * size + sizeof(uint64_t) * bitmap_words(size);
+  }
+
+  // Add a page of at least `count` items, sized by the growth policy.
+  bool grow_next(const size_t count) {
+    // The built-in growth adds a page of twice the current size.
+    const size_t item = sizeof(pool_compact_item<T>);
+    const size_t total = size() * item;
+    const size_t next = _growth.next(total, total + item * count,
+      total + (size() ? size() * 2 : 1) * item);
+
+    return next && grow((next - total) / item);
+  }
+
+  // Page of `item`. `order` holds the page indexes sorted by address for a
+  // binary search, without it the pages are scanned.
+  pool_compact_page<T>* page_of(const pool_compact_item<T>* item, const size_t* order) const {
+    if(!order) {
+      for(size_t i = 0; i < pages_size; i++) {
+        if(item >= pages[i].buffer && item < pages[i].buffer + pages[i].size)
+          return &pages[i];
+      }
+
+      return nullptr;
+    }
+
+    // The first page that starts after `item`, the one before holds it.
+    size_t low = 0;
+    size_t high = pages_size;
+
+    while(low < high) {
+      const size_t middle = (low + high) / 2;
+
+      if(pages[order[middle]].buffer <= item) low = middle + 1;
+      else high = middle;
+    }
+
+    return low ? &pages[order[low - 1]] : nullptr;
+  }
+
+  // A recycled item, else the next item never used.
+  pool_compact_item<T>* next_free() {
+    if(free_ptr) {
+      pool_compact_item<T>* item = free_ptr;
+      free_ptr = item->next;
+
+      return item;
+    }
+
+    while(bump_page < pages_size) {
+      if(bump_index < pages[bump_page].size)
+        return &(pages[bump_page].buffer[bump_index++]);
+
+      bump_page++;
+      bump_index = 0;
+    }
+
+    return nullptr;
+  }
+
+  // Run the destructor of every item in use. The bitmaps start with the
+  // bits of the items handed out since the last reset set, and the items
+  // on the free list are cleared.
+  void destroy_used() {
+    if(!destroy || !_used) return;
+
+    for(size_t i = 0; i < pages_size; i++) {
+      const size_t words = bitmap_words(pages[i].size);
+      const size_t handed_out = i < bump_page ? pages[i].size : (i == bump_page ? bump_index : 0);
+
+      memset(pages[i].occupied, 0, sizeof(uint64_t) * words);
+      memset(pages[i].occupied, 0xff, sizeof(uint64_t) * (handed_out / 64));
+
+      if(handed_out % 64)
+        pages[i].occupied[handed_out / 64] = (static_cast<uint64_t>(1) << (handed_out % 64)) - 1;
+    }
+
+    // Sort the pages by address once, so every free item is found with a
+    // binary search instead of a scan of all pages.
+    size_t* order = free_ptr && pages_size > 1 ?
+      static_cast<size_t*>(malloc(sizeof(size_t) * pages_size)) : nullptr;
+
+    if(order) {
+      for(size_t i = 0; i < pages_size; i++) order[i] = i;
+
+      std::sort(order, order + pages_size, [this](const size_t a, const size_t b) {
+        return pages[a].buffer < pages[b].buffer;
+      });
+    }
+
+    for(pool_compact_item<T>* item = free_ptr; item != nullptr; item = item->next) {
+      pool_compact_page<T>* page = page_of(item, order);
+      const size_t index = item - page->buffer;
+
+      page->occupied[index / 64] &= ~(static_cast<uint64_t>(1) << (index % 64));
+    }
+
+    free(order);
+
+    for(size_t i = 0; i < pages_size; i++) {
+      const pool_compact_page<T> &page = pages[i];
+
+      for(size_t word = 0; word < bitmap_words(page.size); word++) {
+        uint64_t bits = page.occupied[word];
+
+        for(size_t index = word * 64; bits; index++, bits >>= 1) {
+          if(bits & 1) reinterpret_cast<T*>(&page.buffer[index].value)->~T();
+        }
+      }
+    }
+  }
+
+  void release() {
+    #ifdef ARENA_POOL_CPP
+    if(arena) return;
+    #endif
+
+    for(size_t i = 0; i < pages_size; i++)
+      page_free(pages[i].buffer, page_bytes(pages[i].size), _flags);
+
+    free(pages);
+  }
+
+public:
+  #ifdef ARENA_POOL_CPP
+  pool_compact(apc::arena &_arena, const size_t pool_size = 0) : arena(&_arena) {
+    if(pool_size) grow(pool_size);
+  }
+  #endif
+
+  pool_compact(const size_t pool_size = 0, const unsigned flags = page_default) : _flags(flags) {
+    if(pool_size) grow(pool_size);
+  }
+
+  pool_compact(const pool_compact&) = delete;
+  pool_compact& operator=(const pool_compact&) = delete;
+
+  ~pool_compact() {
+    destroy_used();
+    release();
+  }
+
+  void init(const size_t pool_size) {
+    if(pool_size) grow(pool_size);
+  }
+
+  #ifdef ARENA_POOL_CPP
+  void init(apc::arena &_arena, const size_t pool_size) {
+    if(size() == 0) arena = &_arena;
+
+    if(pool_size) grow(pool_size);
+  }
+  #endif
+
+  T* allocate_raw() {
+    pool_compact_item<T>* item = next_free();
+
+    if(!item) {
+      if(!grow_next(1)) return nullptr;
+
+      item = next_free();
+    }
+
+    _used++;
+
+    APC_TRACE_EVENT(trace_pool_allocate, this, &item->value, sizeof(T), alignof(T));
+
+    return reinterpret_cast<T*>(&item->value);
+  }
+
+  template <typename... Args>
+  T* allocate_new(Args&&... args) {
+    T* new_item = allocate_raw();
+
+    if(!new_item) return nullptr;
+
+    return new (new_item) T(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  T* allocate(U &item) {
+    T* new_item = allocate_raw();
+
+    if(!new_item) return nullptr;
+
+    if(std::is_trivially_copyable<T>::value || FORCE_TRIVIAL_COPY)
+      memcpy(new_item, &item, sizeof(T));
+    else
+      new (new_item) T(std::forward<U>(item));
+
+    return new_item;
+  }
+
+  template <typename U>
+  T* allocate(U &&item) {
+    return allocate(item);
+  }
+
+  void deallocate(T* ptr) {
+    if(ptr == nullptr) return;
+
+    APC_TRACE_EVENT(trace_pool_deallocate, this, ptr, sizeof(T));
+
+    if(destroy) ptr->~T();
+
+    pool_compact_item<T>* item = reinterpret_cast<pool_compact_item<T>*>(ptr);
+    item->next = free_ptr;
+    free_ptr = item;
+    _used--;
+  }
+
+  // Destroy the items in use, and start over from the first item. O(1)
+  // for trivially destructible T.
+  void reset() {
+    destroy_used();
+
+    free_ptr = nullptr;
+    bump_page = 0;
+    bump_index = 0;
+    _used = 0;
+  }
+
+  bool grow(const size_t size) {
+    if(!size) return false;
+
+    const size_t bytes = page_bytes(size);
+    pool_compact_item<T>* new_buffer = nullptr;
+    size_t new_count = pages_size + 1;
+
+    #ifdef ARENA_POOL_CPP
+    if(arena)
+      new_buffer = static_cast<pool_compact_item<T>*>(
+        arena->allocate_raw(bytes, alignof(pool_compact_item<T>))
+      );
+    else
+    #endif
+      new_buffer = static_cast<pool_compact_item<T>*>(page_allocate(bytes, _flags));
+
+    if(!new_buffer) return false;
+
+    pool_compact_page<T>* new_list = nullptr;
+
+    #ifdef ARENA_POOL_CPP
+    if(arena) {
+      new_list = arena->allocate_size<pool_compact_page<T>>(new_count);
+
+      if(new_list && pages_size)
+        memcpy(new_list, pages, sizeof(pool_compact_page<T>) * pages_size);
+    } else
+    #endif
+      new_list = static_cast<pool_compact_page<T>*>(
+        realloc(pages, sizeof(pool_compact_page<T>) * new_count)
+      );
+
+    if(!new_list) {
+      #ifdef ARENA_POOL_CPP
+      if(!arena)
+      #endif
+        page_free(new_buffer, bytes, _flags);
+
+      return false;
+    }
+
+    new_list[new_count - 1] = {
+      new_buffer,
+      destroy ? reinterpret_cast<uint64_t*>(new_buffer + size) : nullptr,
+      size
+    };
+    pages = new_list;
+    pages_size = new_count;
+
+    return true;
+  }
+
+  size_t size() const {
+    size_t total_size = 0;
+
+    for(size_t i = 0; i < pages_size; i++) {
+      total_size += pages[i].size;
+    }
+
+    return total_size;
+  }
+
+  size_t used() const {
+    return _used;
+  }
+
+  unsigned flags() const {
+    return _flags;
+  }
+
+  // How new pages are sized when the pool runs out of free items, see
+  // `growth_policy`.
+  void growth(const growth_policy &policy) {
+    _growth = policy;
+  }
+
+  const growth_policy& growth() const {
+    return _growth;
+  }
+};
+
 }
@@ -0,0 +1,189 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string.h>
+#include "./arena.h"
+#include "./offset_ptr.h"
+
+#ifdef APC_PAGE_MMAP
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace apc {
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t pointer_size;
+  // Where the data starts in the file. Keeps the data at the same address
+  // modulo 64 as it had in the arena, so alignments up to 64 are kept.
+  uint64_t data_offset;
+  uint64_t size;
+  // Offset of the root object from the start of the data.
+  uint64_t root;
+};
+
+static const char snapshot_magic[8] = { 'A', 'P', 'C', 'S', 'N', 'A', 'P', 0 };
+static const uint32_t snapshot_version = 1;
+static const uint64_t snapshot_no_root = ~static_cast<uint64_t>(0);
+
+// Write the memory of `arena` to `path`, to be loaded again with an
+// `arena_snapshot`. The arena must be one contiguous buffer (see
+// arena::data()), and everything in it must be relocatable: plain data and
+// offset_ptr/offset_array, not raw pointers. `root` must be in the arena.
+inline bool snapshot_write(const apc::arena &arena, const char* path,
+  const void* root = nullptr
+) {
+  const char* data = arena.data();
+  const size_t size = arena.used();
+
+  if(!data) return false;
+
+  const char* root_ptr = static_cast<const char*>(root);
+
+  if(root_ptr && (root_ptr < data || root_ptr >= data + size)) return false;
+
+  snapshot_header header;
+  memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+  header.version = snapshot_version;
+  header.pointer_size = sizeof(void*);
+  header.data_offset = 64 + (reinterpret_cast<uintptr_t>(data) & 63);
+  header.size = size;
+  header.root = root_ptr ? root_ptr - data : snapshot_no_root;
+
+  FILE* file = fopen(path, "wb");
+
+  if(!file) return false;
+
+  static const char padding[128] = {};
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(padding, header.data_offset - sizeof(header), 1, file) == 1 &&
+    (!size || fwrite(data, size, 1, file) == 1);
+
+  return fclose(file) == 0 && ok;
+}
+
+// A snapshot file mapped read-only into memory. Nothing needs to be fixed
+// up after loading, the structures in it are used in place.
+class arena_snapshot {
+private:
+  void* map = nullptr;
+  size_t map_size = 0;
+  const char* _data = nullptr;
+  size_t _size = 0;
+  const void* _root = nullptr;
+
+public:
+  arena_snapshot() { }
+
+  explicit arena_snapshot(const char* path) {
+    load(path);
+  }
+
+  arena_snapshot(const arena_snapshot&) = delete;
+  arena_snapshot& operator=(const arena_snapshot&) = delete;
+
+  ~arena_snapshot() {
+    close();
+  }
+
+  bool load(const char* path) {
+    close();
+
+    #ifdef APC_PAGE_MMAP
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0) return false;
+
+    struct stat info;
+
+    if(fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(snapshot_header)
+    ) {
+      ::close(fd);
+
+      return false;
+    }
+
+    void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    ::close(fd);
+
+    if(memory == MAP_FAILED) return false;
+
+    map = memory;
+    map_size = info.st_size;
+
+    const snapshot_header* header = static_cast<const snapshot_header*>(map);
+
+    if(memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+      header->version != snapshot_version ||
+      header->pointer_size != sizeof(void*) ||
+      header->data_offset > map_size ||
+      header->size > map_size - header->data_offset ||
+      (header->root != snapshot_no_root && header->root >= header->size)
+    ) {
+      close();
+
+      return false;
+    }
+
+    _data = static_cast<const char*>(map) + header->data_offset;
+    _size = header->size;
+
+    if(header->root != snapshot_no_root) _root = _data + header->root;
+
+    return true;
+    #else
+    (void)path;
+
+    return false;
+    #endif
+  }
+
+  void close() {
+    #ifdef APC_PAGE_MMAP
+    if(map) munmap(map, map_size);
+    #endif
+
+    map = nullptr;
+    map_size = 0;
+    _data = nullptr;
+    _size = 0;
+    _root = nullptr;
+  }
+
+  bool loaded() const {
+    return _data != nullptr;
+  }
+
+  template <typename T>
+  const T* root() const {
+    return static_cast<const T*>(_root);
+  }
+
+  const char* data() const {
+    return _data;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+};
+
+}
@@ -11,7 +11,11 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <cstdlib>
 #include <ostream>
+#include <string.h>
+#include "./trace.h"
 
 namespace apc {
 
@@ -486,7 +490,19 @@ class str_dynamic {
     }
 
     resize(new_size);
+
+    APC_TRACE_EVENT(trace_str_resize, this, buffer, _size + 1, 1, trace_flags());
+  }
+
+  #ifdef APC_TRACE
+  uint8_t trace_flags() const {
+    #ifdef ARENA_POOL_CPP
+    if(_arena) return trace_flag_arena;
+    #endif
+
+    return 0;
   }
+  #endif
 
   void moved_reset() {
     buffer = static_buffer;
@@ -574,6 +590,9 @@ public:
   #endif
 
   ~str_dynamic() {
+    if(buffer != static_buffer)
+      APC_TRACE_EVENT(trace_str_resize, this, nullptr, 0, 1, trace_flags());
+
     if(
       #ifdef ARENA_POOL_CPP
       _arena == nullptr &&
@@ -633,6 +652,7 @@ public:
       
       #ifdef ARENA_POOL_CPP
       if(!_arena) free(buffer);
+      else _arena->free_last(buffer, _size + 1);
       #else
       free(buffer);
       #endif
@@ -660,9 +680,12 @@ public:
 
         #ifdef ARENA_POOL_CPP
         if(_arena) {
-          new_buffer = _arena->allocate_size<char>(size + 1);
+          if(_arena->try_extend(buffer, _size + 1, size + 1))
+            new_buffer = buffer;
+          else
+            new_buffer = _arena->allocate_size<char>(size + 1);
 
-          if(new_buffer) {
+          if(new_buffer && new_buffer != buffer) {
             memcpy(new_buffer, buffer, _used < size ? _used : size);
           }
         } else
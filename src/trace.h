@@ -0,0 +1,135 @@
+/*
+ * Package: arena_pool_cpp
+ * Version: 0.3.0
+ * License: MIT
+ * Github: https://github.com/royhansen99/arena-pool-cpp
+ * Author: Roy Hansen (https://github.com/royhansen99)
+ * Description: A very fast memory allocator library with an arena/bump-allocator,
+ *              a pool-allocator, a hashmap-allocator,  and a vector-like
+ *              array-allocator. Also includes a string implementation.
+ *              Single header c++11 library.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string.h>
+
+namespace apc {
+
+// Allocation tracing. Define `APC_TRACE` before including any of the
+// headers to record every arena/pool allocation and vector/str growth
+// between trace_start() and trace_stop() to a binary file, which
+// tests/trace_replay.cpp can replay.
+enum trace_op : uint8_t {
+  trace_arena_allocate = 1,
+  trace_arena_reset = 2,
+  trace_arena_release = 3,
+  trace_pool_allocate = 4,
+  trace_pool_deallocate = 5,
+  // The buffer of a vector/str was resized to `size` bytes (0 when it is
+  // freed).
+  trace_vector_resize = 6,
+  trace_str_resize = 7,
+  // The arena allocation at `address` was resized in place to `size`
+  // bytes (try_extend()), or given back (free_last()).
+  trace_arena_extend = 8,
+  trace_arena_free_last = 9,
+};
+
+enum trace_flags : uint8_t {
+  // The vector/str buffer lives in an arena, so its memory is already in
+  // the trace as arena allocations.
+  trace_flag_arena = 1 << 0,
+};
+
+// One event in the trace file, which is a "APCTRACE" magic followed by
+// events until the end of the file.
+struct trace_event {
+  // Address of the allocator or container, which identifies it.
+  uint64_t object;
+  uint64_t address;
+  uint64_t size;
+  uint32_t alignment;
+  uint8_t op;
+  uint8_t flags;
+  uint16_t reserved;
+};
+
+static const char trace_magic[8] = { 'A', 'P', 'C', 'T', 'R', 'A', 'C', 'E' };
+
+struct trace_state {
+  std::mutex mutex;
+  FILE* file = nullptr;
+  trace_event buffer[4096];
+  size_t count = 0;
+};
+
+inline trace_state& trace_global() {
+  static trace_state state;
+
+  return state;
+}
+
+// Start recording to `path`. Events are buffered, trace_stop() writes the
+// rest and closes the file.
+inline bool trace_start(const char* path) {
+  trace_state &state = trace_global();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if(state.file) return false;
+
+  state.file = fopen(path, "wb");
+
+  if(!state.file) return false;
+
+  state.count = 0;
+
+  return fwrite(trace_magic, sizeof(trace_magic), 1, state.file) == 1;
+}
+
+inline void trace_stop() {
+  trace_state &state = trace_global();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if(!state.file) return;
+
+  if(state.count) fwrite(state.buffer, sizeof(trace_event), state.count, state.file);
+
+  fclose(state.file);
+  state.file = nullptr;
+  state.count = 0;
+}
+
+inline void trace_record(const uint8_t op, const void* object, const void* address,
+  const size_t size, const size_t alignment = 0, const uint8_t flags = 0
+) {
+  trace_state &state = trace_global();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if(!state.file) return;
+
+  trace_event &event = state.buffer[state.count++];
+  event.object = reinterpret_cast<uintptr_t>(object);
+  event.address = reinterpret_cast<uintptr_t>(address);
+  event.size = size;
+  event.alignment = static_cast<uint32_t>(alignment);
+  event.op = op;
+  event.flags = flags;
+  event.reserved = 0;
+
+  if(state.count == sizeof(state.buffer) / sizeof(trace_event)) {
+    fwrite(state.buffer, sizeof(trace_event), state.count, state.file);
+    state.count = 0;
+  }
+}
+
+}
+
+#ifdef APC_TRACE
+#define APC_TRACE_EVENT(...) apc::trace_record(__VA_ARGS__)
+#else
+#define APC_TRACE_EVENT(...) ((void)0)
+#endif
@@ -11,6 +11,17 @@
  */
 #pragma once
 
+#include <cstdlib>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <string.h>
+#include "./growth.h"
+#include "./page.h"
+#include "./trace.h"
+
 #ifdef ARENA_POOL_CPP
 #include "./arena.h"
 #endif
@@ -358,7 +369,7 @@ public:
   }
 
   #ifdef ARENA_POOL_CPP
-  arena* arena() const {
+  apc::arena* arena() const {
     return nullptr;
   }
   #endif
@@ -406,9 +417,14 @@ public:
 template <typename T, bool FORCE_TRIVIAL_COPY = false>
 class vector final : public ivector<T> {
   #ifdef ARENA_POOL_CPP
-  arena* _arena;
+  apc::arena* _arena;
   #endif
 
+  growth_policy _growth;
+
+public:
+  typedef typename ivector<T>::iterator iterator;
+
 protected:
   void moved_reset() {
     this->buffer = nullptr;
@@ -417,21 +433,36 @@ protected:
   }
 
   void maybe_grow(const size_t &count) {
-    if(!this->buffer_size) {
-      this->init(count);
+    if((this->buffer_size - this->_used) >= count) return;
 
-      return;
-    }
+    // The built-in growth doubles the buffer, and the first buffer fits
+    // exactly `count`.
+    const size_t next = _growth.next(
+      sizeof(T) * this->buffer_size,
+      sizeof(T) * (this->_used + count),
+      sizeof(T) * (this->buffer_size ? this->buffer_size * 2 : count)
+    );
 
-    if((this->buffer_size - this->_used) >= count) return;
+    if(!next) return;
 
-    size_t new_size = this->buffer_size * 2;
-    size_t min = this->_used + count; 
+    if(!this->buffer_size)
+      this->init(next / sizeof(T));
+    else
+      this->resize(next / sizeof(T));
+
+    APC_TRACE_EVENT(trace_vector_resize, this, this->buffer,
+      sizeof(T) * this->buffer_size, alignof(T), trace_flags());
+  }
 
-    if(new_size < min) new_size = min;
+  #ifdef APC_TRACE
+  uint8_t trace_flags() const {
+    #ifdef ARENA_POOL_CPP
+    if(_arena) return trace_flag_arena;
+    #endif
 
-    this->resize(new_size);
+    return 0;
   }
+  #endif
 
 public:
   vector(const size_t size = 0) :
@@ -478,6 +509,7 @@ public:
     if(other.arena()) _arena = other.arena();
     #endif
 
+    _growth = other._growth;
     this->buffer = other.buffer;
     this->_used = other._used;
     this->buffer_size = other.buffer_size;
@@ -488,6 +520,7 @@ public:
   vector(const vector<T>& other) :
     vector(*other._arena, other.buffer_size)
   {
+    _growth = other._growth;
     this->operator=(other);
   }
 
@@ -504,23 +537,23 @@ public:
   }
 
   #ifdef ARENA_POOL_CPP
-  vector(arena &__arena, const size_t size) : ivector<T>(), _arena(nullptr) {
+  vector(apc::arena &__arena, const size_t size) : ivector<T>(), _arena(nullptr) {
     init(__arena, size);
   }
 
-  vector(arena &__arena, const size_t size, const std::initializer_list<T> list) :
+  vector(apc::arena &__arena, const size_t size, const std::initializer_list<T> list) :
     vector(__arena, size) 
   {
     this->operator=(&list);
   }
 
-  vector(arena &__arena, const size_t size, const std::vector<T>& other) :
+  vector(apc::arena &__arena, const size_t size, const std::vector<T>& other) :
     vector(__arena, size) 
   {
     this->operator=(other);
   }
 
-  vector(arena &__arena, const size_t size, const ivector<T>& other) :
+  vector(apc::arena &__arena, const size_t size, const ivector<T>& other) :
     vector(__arena, size) 
   {
     this->operator=(other);
@@ -528,6 +561,9 @@ public:
   #endif
 
   ~vector() {
+    if(this->buffer_size)
+      APC_TRACE_EVENT(trace_vector_resize, this, nullptr, 0, alignof(T), trace_flags());
+
     if(!std::is_trivially_destructible<T>::value && !FORCE_TRIVIAL_COPY) {
       for(size_t i = 0; i < this->_used; i++)
         this->buffer[i].~T();
@@ -633,13 +669,11 @@ public:
   }
 
   void init(const size_t size) {
-    if(
-      !size ||
-      #ifdef ARENA_POOL_CPP
-      _arena ||
-      #endif
-      this->buffer_size
-    ) return;
+    if(!size || this->buffer_size) return;
+
+    #ifdef ARENA_POOL_CPP
+    if(_arena) return init(*_arena, size);
+    #endif
 
     this->buffer = static_cast<T*>(malloc(sizeof(T) * size));
 
@@ -647,13 +681,18 @@ public:
   }
 
   #ifdef ARENA_POOL_CPP
-  void init(arena &__arena, const size_t size) {
-    if(!size || _arena || this->buffer_size) return;
+  // The vector is bound to the arena even with a size of 0, so it grows in
+  // the arena later.
+  void init(apc::arena &__arena, const size_t size) {
+    if(this->buffer_size || (_arena && _arena != &__arena)) return;
+
+    _arena = &__arena;
+
+    if(!size) return;
 
     auto* new_buffer = __arena.allocate_size<T>(size);
 
     if(new_buffer) {
-      _arena = &__arena;
       this->buffer = new_buffer;
       this->buffer_size = size;
     }
@@ -679,7 +718,14 @@ public:
           this->_used = size;
         }
 
+        // Give the space back if this is the last allocation in the arena.
+        _arena->try_extend(this->buffer, sizeof(T) * this->buffer_size, sizeof(T) * size);
+
         this->buffer_size = size;
+      } else if(_arena->try_extend(this->buffer, sizeof(T) * this->buffer_size, sizeof(T) * size)) {
+        this->buffer_size = size;
+
+        return true;
       } else {
         new_buffer = _arena->allocate_size<T>(size);
 
@@ -743,8 +789,34 @@ public:
     return 0;
   }
 
+  // Touch the unused part of the buffer, so the items added to it do not
+  // take page faults.
+  void prefault() {
+    page_touch(this->buffer + this->_used, sizeof(T) * (this->buffer_size - this->_used));
+  }
+
+  // Make room for `count` more items ahead of time, and prefault it.
+  bool warm(const size_t count) {
+    maybe_grow(count);
+
+    if(this->buffer_size - this->_used < count) return false;
+
+    prefault();
+
+    return true;
+  }
+
+  // How the buffer grows when it runs out of room, see `growth_policy`.
+  void growth(const growth_policy &policy) {
+    _growth = policy;
+  }
+
+  const growth_policy& growth() const {
+    return _growth;
+  }
+
   #ifdef ARENA_POOL_CPP
-  arena* arena() const {
+  apc::arena* arena() const {
     return _arena;
   }
   #endif
@@ -0,0 +1,85 @@
+// COMPILE: g++ -std=c++11 -O3 -march=native benchmarks_arena_cache.cpp
+
+#include "../src/arena.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using Clock = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+// One simulated request: construct an arena, make allocations of mixed
+// sizes (about 4 MiB in total, so the arena grows a few times), destroy.
+static size_t request(apc::arena &arena) {
+  size_t sum = 0;
+
+  for(size_t i = 0; i < 4096; i++) {
+    char* p = arena.allocate_size<char>(64 + (i % 16) * 120);
+    p[0] = static_cast<char>(i);
+    sum += p[0];
+  }
+
+  return sum;
+}
+
+int main() {
+  const size_t N = 2000; // Requests.
+  const size_t INITIAL = 64 * 1024;
+  size_t sum = 0;
+
+  printf("Benchmarking %ld requests of construct/allocate/destroy arena\n", N);
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  // --------------------------------------------------------------
+  // apc::arena (malloc/free)
+  // --------------------------------------------------------------
+  {
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i++) {
+      apc::arena arena(INITIAL);
+      sum += request(arena);
+    }
+    auto t1 = Clock::now();
+    double request_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "apc::arena                  request: " << std::setw(10) << request_ns << " ns\n";
+  }
+
+  // --------------------------------------------------------------
+  // apc::arena (arena_cache)
+  // --------------------------------------------------------------
+  {
+    apc::arena_cache cache;
+
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i++) {
+      apc::arena arena(cache, INITIAL);
+      sum += request(arena);
+    }
+    auto t1 = Clock::now();
+    double request_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "apc::arena (arena_cache)    request: " << std::setw(10) << request_ns
+              << " ns  (hits: " << cache.hits() << ", misses: " << cache.misses() << ")\n";
+  }
+
+  // --------------------------------------------------------------
+  // apc::arena (arena_cache + page_prefault)
+  // --------------------------------------------------------------
+  {
+    apc::arena_cache cache(64 * 1024 * 1024, apc::page_prefault);
+
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i++) {
+      apc::arena arena(cache, INITIAL);
+      sum += request(arena);
+    }
+    auto t1 = Clock::now();
+    double request_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "apc::arena (cache+prefault) request: " << std::setw(10) << request_ns << " ns\n";
+  }
+
+  return sum == 0;
+}
@@ -0,0 +1,108 @@
+// COMPILE: g++ -std=c++11 -O3 -march=native benchmarks_batch.cpp
+
+#include "../src/arena.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using Clock = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+struct Node {
+  int kind;
+  Node* children;
+  size_t children_size;
+};
+
+struct Token {
+  const char* text;
+  size_t size;
+};
+
+int main() {
+  const size_t N = 1000000; // Objects.
+  const size_t CHILDREN = 8;
+  size_t sum = 0;
+
+  printf("Benchmarking %ld objects, individual vs batch allocation\n", N);
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  // Prefaulted, so the first benchmark does not pay for the page faults.
+  apc::arena arena(N * (sizeof(Node) + sizeof(Token)) * 2, apc::page_prefault);
+
+  // --------------------------------------------------------------
+  // N objects of one type
+  // --------------------------------------------------------------
+  {
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i += CHILDREN) {
+      Node* first = arena.allocate_new<Node>();
+
+      for(size_t j = 1; j < CHILDREN; j++)
+        arena.allocate_new<Node>();
+
+      sum += reinterpret_cast<uintptr_t>(first);
+    }
+    auto t1 = Clock::now();
+    double object_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "allocate_new<Node>      object: " << std::setw(8) << object_ns << " ns\n";
+  }
+
+  arena.reset();
+
+  {
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i += CHILDREN) {
+      Node* children = arena.allocate_new_n<Node>(CHILDREN);
+
+      sum += reinterpret_cast<uintptr_t>(children);
+    }
+    auto t1 = Clock::now();
+    double object_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "allocate_new_n<Node>    object: " << std::setw(8) << object_ns << " ns\n";
+  }
+
+  arena.reset();
+
+  // --------------------------------------------------------------
+  // A node with its children and a token
+  // --------------------------------------------------------------
+  {
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i += CHILDREN + 2) {
+      Node* node = arena.allocate_size<Node>();
+      Node* children = arena.allocate_size<Node>(CHILDREN);
+      Token* token = arena.allocate_size<Token>();
+
+      sum += reinterpret_cast<uintptr_t>(node) + reinterpret_cast<uintptr_t>(children) +
+        reinterpret_cast<uintptr_t>(token);
+    }
+    auto t1 = Clock::now();
+    double object_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "allocate_size x3        object: " << std::setw(8) << object_ns << " ns\n";
+  }
+
+  arena.reset();
+
+  {
+    auto t0 = Clock::now();
+    for(size_t i = 0; i < N; i += CHILDREN + 2) {
+      std::tuple<Node*, Node*, Token*> batch =
+        arena.allocate_batch<Node, Node, Token>({ 1, CHILDREN, 1 });
+
+      sum += reinterpret_cast<uintptr_t>(std::get<0>(batch)) +
+        reinterpret_cast<uintptr_t>(std::get<1>(batch)) +
+        reinterpret_cast<uintptr_t>(std::get<2>(batch));
+    }
+    auto t1 = Clock::now();
+    double object_ns = std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+
+    std::cout << "allocate_batch          object: " << std::setw(8) << object_ns << " ns\n";
+  }
+
+  return sum == 0;
+}
@@ -0,0 +1,107 @@
+// COMPILE: g++ -std=c++11 -O3 -march=native -pthread benchmarks_concurrent.cpp
+
+#include "../src/arena.h"
+#include "../src/arena_concurrent.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+// Runs `work(thread_index)` on `threads_count` threads and returns the
+// throughput in million allocations per second.
+template <typename F>
+double run(const size_t threads_count, const size_t N, F work) {
+  std::vector<std::thread> threads;
+
+  auto t0 = Clock::now();
+  for(size_t t = 0; t < threads_count; t++)
+    threads.emplace_back(work, t);
+
+  for(auto &thread : threads) thread.join();
+  auto t1 = Clock::now();
+
+  double seconds = std::chrono::duration_cast<ns>(t1 - t0).count() / 1e9;
+
+  return (threads_count * N) / seconds / 1e6;
+}
+
+int main() {
+  const size_t N = 2000000; // Allocations per thread.
+  const size_t ALLOC_SIZE = 16;
+  size_t max_threads = std::thread::hardware_concurrency();
+
+  if(!max_threads) max_threads = 1;
+
+  printf("Benchmarking %ld allocations of %ld bytes per thread (Mallocs/s, higher is better)\n", N, ALLOC_SIZE);
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "threads    arena_concurrent_local    arena_concurrent (shared)    apc::arena + mutex\n";
+
+  for(size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    const size_t total = threads_count * N * ALLOC_SIZE * 2;
+
+    // --------------------------------------------------------------
+    // apc::arena_concurrent_local (per-thread chunks)
+    // --------------------------------------------------------------
+    double local_mops;
+    {
+      apc::arena_concurrent arena(total);
+
+      local_mops = run(threads_count, N, [&arena, N, ALLOC_SIZE](size_t) {
+        apc::arena_concurrent_local local(arena);
+
+        for(size_t i = 0; i < N; i++) {
+          char* p = static_cast<char*>(local.allocate_raw(ALLOC_SIZE, 8));
+          p[0] = static_cast<char>(i);
+        }
+      });
+    }
+
+    // --------------------------------------------------------------
+    // apc::arena_concurrent (one atomic add per allocation)
+    // --------------------------------------------------------------
+    double shared_mops;
+    {
+      apc::arena_concurrent arena(total);
+
+      shared_mops = run(threads_count, N, [&arena, N, ALLOC_SIZE](size_t) {
+        for(size_t i = 0; i < N; i++) {
+          char* p = static_cast<char*>(arena.allocate_raw(ALLOC_SIZE, 8));
+          p[0] = static_cast<char>(i);
+        }
+      });
+    }
+
+    // --------------------------------------------------------------
+    // apc::arena behind a std::mutex
+    // --------------------------------------------------------------
+    double mutex_mops;
+    {
+      apc::arena arena(total);
+      std::mutex mutex;
+
+      mutex_mops = run(threads_count, N, [&arena, &mutex, N, ALLOC_SIZE](size_t) {
+        for(size_t i = 0; i < N; i++) {
+          char* p;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            p = static_cast<char*>(arena.allocate_raw(ALLOC_SIZE, 8));
+          }
+          p[0] = static_cast<char>(i);
+        }
+      });
+    }
+
+    std::cout << std::setw(7) << threads_count
+              << std::setw(26) << local_mops
+              << std::setw(29) << shared_mops
+              << std::setw(22) << mutex_mops << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+// COMPILE: g++ -std=c++17 -O3 -march=native benchmarks_pmr.cpp
+
+#include "../src/arena.h"
+#include "../src/allocator.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+
+using Clock = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+// Builds an unordered_map of N items, and returns ns per insert.
+double monotonic_run(std::pmr::memory_resource* resource, const size_t N) {
+  auto t0 = Clock::now();
+  {
+    std::pmr::unordered_map<size_t, size_t> map(resource);
+
+    for(size_t i = 0; i < N; i++) map[i] = i;
+  }
+  auto t1 = Clock::now();
+
+  return std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+}
+
+// Pushes and pops list nodes in waves of 1000, and returns ns per
+// push/pop pair.
+double pool_run(std::pmr::memory_resource* resource, const size_t N) {
+  auto t0 = Clock::now();
+  {
+    std::pmr::list<size_t> list(resource);
+
+    for(size_t i = 0; i < N / 1000; i++) {
+      for(size_t z = 0; z < 1000; z++) list.push_back(z);
+      for(size_t z = 0; z < 1000; z++) list.pop_front();
+    }
+  }
+  auto t1 = Clock::now();
+
+  return std::chrono::duration_cast<ns>(t1 - t0).count() / double(N);
+}
+
+int main() {
+  const size_t N = 1000000;
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  printf("Benchmarking %ld std::pmr::unordered_map inserts (monotonic)\n", N);
+
+  {
+    apc::arena arena(64 * 1024 * 1024);
+    apc::arena_resource resource(arena);
+
+    std::cout << "apc::arena_resource                   " << std::setw(6)
+              << monotonic_run(&resource, N) << " ns\n";
+  }
+
+  {
+    std::pmr::monotonic_buffer_resource resource(64 * 1024 * 1024);
+
+    std::cout << "std::pmr::monotonic_buffer_resource   " << std::setw(6)
+              << monotonic_run(&resource, N) << " ns\n";
+  }
+
+  {
+    std::cout << "std::pmr::new_delete_resource         " << std::setw(6)
+              << monotonic_run(std::pmr::new_delete_resource(), N) << " ns\n";
+  }
+
+  printf("\nBenchmarking %ld std::pmr::list push/pop pairs (pool)\n", N);
+
+  {
+    apc::pool_resource resource;
+
+    std::cout << "apc::pool_resource                    " << std::setw(6)
+              << pool_run(&resource, N) << " ns\n";
+  }
+
+  {
+    apc::arena arena(1024 * 1024);
+    apc::pool_resource resource(arena);
+
+    std::cout << "apc::pool_resource (arena)            " << std::setw(6)
+              << pool_run(&resource, N) << " ns\n";
+  }
+
+  {
+    std::pmr::unsynchronized_pool_resource resource;
+
+    std::cout << "std::pmr::unsynchronized_pool_resource" << std::setw(6)
+              << pool_run(&resource, N) << " ns\n";
+  }
+
+  {
+    std::cout << "std::pmr::new_delete_resource         " << std::setw(6)
+              << pool_run(std::pmr::new_delete_resource(), N) << " ns\n";
+  }
+
+  return 0;
+}
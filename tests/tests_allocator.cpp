@@ -0,0 +1,127 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_allocator.cpp
+// COMPILE: g++ -std=c++17 -Wall -fsanitize=address tests_allocator.cpp
+
+#include "../src/arena.h"
+#include "../src/allocator.h"
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+int main() {
+  std::cout << "Running Allocator tests...\n";
+
+  // ------------------------------------------------------------------
+  // arena_allocator with std containers
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+
+    apc::arena_allocator<int> allocator(arena);
+    std::vector<int, apc::arena_allocator<int>> vec(allocator);
+
+    for(int i = 0; i < 100; i++) vec.push_back(i);
+
+    assert(vec.size() == 100 && vec[99] == 99 && arena.used() >= sizeof(int) * 100);
+
+    typedef std::basic_string<char, std::char_traits<char>, apc::arena_allocator<char>> arena_string;
+    arena_string str("A string that is too long for the small string buffer", arena);
+    assert(str.size() > 32);
+
+    typedef std::pair<const int, int> pair;
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, apc::arena_allocator<pair>>
+      map(16, std::hash<int>(), std::equal_to<int>(), apc::arena_allocator<pair>(arena));
+
+    for(int i = 0; i < 100; i++) map[i] = i * 2;
+
+    assert(map.size() == 100 && map[50] == 100);
+
+    // Rebound allocators compare equal when they share the arena.
+    apc::arena other(16);
+    assert(
+      apc::arena_allocator<char>(allocator) == allocator &&
+      apc::arena_allocator<int>(other) != allocator
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Out of memory throws std::bad_alloc
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(0);
+    arena.reserve(4096);
+
+    std::vector<char, apc::arena_allocator<char>> vec((apc::arena_allocator<char>(arena)));
+    bool thrown = false;
+
+    try {
+      vec.resize(8192);
+    } catch(const std::bad_alloc&) {
+      thrown = true;
+    }
+
+    assert(thrown);
+  }
+
+  #ifdef APC_ALLOCATOR_PMR
+  // ------------------------------------------------------------------
+  // arena_resource
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+    apc::arena_resource resource(arena);
+
+    std::pmr::vector<int> vec(&resource);
+    for(int i = 0; i < 100; i++) vec.push_back(i);
+
+    std::pmr::string str("A string that is too long for the small string buffer", &resource);
+    std::pmr::unordered_map<int, std::pmr::string> map(&resource);
+    map[1] = "one";
+
+    assert(
+      vec[99] == 99 &&
+      str.size() > 32 &&
+      map[1] == "one" &&
+      arena.used() >= sizeof(int) * 100
+    );
+
+    apc::arena_resource same(arena);
+    assert(resource.is_equal(same));
+  }
+
+  // ------------------------------------------------------------------
+  // pool_resource
+  // ------------------------------------------------------------------
+  {
+    apc::pool_resource resource;
+
+    {
+      std::pmr::map<int, int> map(&resource);
+
+      for(int i = 0; i < 1000; i++) map[i] = i;
+
+      assert(resource.used() == 1000);
+
+      for(int i = 0; i < 500; i++) map.erase(i);
+
+      assert(resource.used() == 500 && map[999] == 999);
+
+      // Big blocks go to the upstream resource.
+      std::pmr::vector<char> big(10000, 'x', &resource);
+      assert(big[9999] == 'x');
+    }
+
+    assert(resource.used() == 0);
+
+    apc::arena arena(4096);
+    apc::pool_resource arena_resource(arena);
+    std::pmr::vector<int> vec(&arena_resource);
+
+    for(int i = 0; i < 100; i++) vec.push_back(i);
+
+    assert(vec[99] == 99 && arena.used() > 0);
+  }
+  #endif
+}
@@ -6,6 +6,16 @@
 #include <cstring>
 #include <iostream>
 
+struct Finalized {
+  static int destroyed;
+  int value;
+
+  Finalized(int _value) : value(_value) { }
+  ~Finalized() { destroyed = destroyed * 10 + value; }
+};
+
+int Finalized::destroyed = 0;
+
 int main() {
   std::cout << "Running Arena tests...\n";
 
@@ -142,23 +152,98 @@ int main() {
     // Resize (and reset) child arena to a smaller size.
     child_arena.resize(100);
 
-    // Resizing the child arena simply abandoned the old
-    // buffer without freeing it, and allocated a brand
-    // new buffer with the new size.
+    // The old buffer was the last allocation in the parent,
+    // so it was given back before the new one was allocated.
     assert(
       child_arena.size() == 100 &&
-      arena.used() > (256 + 100)
+      arena.used() > 100 &&
+      arena.used() < 256
     );
 
-    // Resizing should fail because the parent does not
-    // have enough space.
     assert(
       child_arena.resize(300) &&
       child_arena.size() == 300 &&
-      arena.used() > (256 + 100 + 300)
+      arena.used() > 300 &&
+      arena.used() < (256 + 100)
     );
   }
 
+  // ------------------------------------------------------------------
+  // Child arenas give their pages back to the parent
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(4096);
+
+    for(int i = 0; i < 100; i++) {
+      apc::arena child(arena, 64);
+
+      // Grow the child past its first page.
+      for(int j = 0; j < 10; j++) {
+        assert(child.allocate_size<char>(50));
+      }
+
+      assert(child.size() > 64 && arena.used() > child.size());
+
+      child.reset();
+
+      assert(child.size() == 64 && child.used() == 0);
+
+      child.allocate_size<char>(100);
+    }
+
+    // Every child gave all its pages back on destruction.
+    assert(arena.used() == 0 && arena.size() == 4096);
+
+    // Pages can not be given back once the parent has allocated
+    // after them.
+    char* last = nullptr;
+    {
+      apc::arena child(arena, 64);
+      last = arena.allocate_size<char>(8);
+    }
+
+    assert(last && arena.used() > 64);
+
+    assert(arena.free_last(last, 8) && arena.used() > 64);
+
+    // Nor after the parent was reset.
+    arena.reset();
+    {
+      apc::arena child(arena, 64);
+      arena.reset();
+      assert(arena.allocate_size<char>(64 + 32));
+    }
+
+    assert(arena.used() >= 64 + 32);
+
+    // Nor after the parent was rewound to before them.
+    arena.reset();
+    size_t taken = 0;
+    {
+      const apc::arena_mark mark = arena.mark();
+      apc::arena child(arena, 64);
+      taken = arena.used();
+      arena.rewind(mark);
+      // Takes the same memory the child page had.
+      assert(arena.allocate_size<char>(taken));
+    }
+
+    assert(arena.used() == taken);
+
+    // The pages of the parent can not be freed while a child uses them.
+    {
+      apc::arena child(arena, 64);
+
+      assert(!arena.resize(128) && arena.size() == 4096);
+
+      #ifdef APC_ARENA_VIRTUAL
+      assert(!arena.reserve(1024 * 1024) && arena.reserved_size() == 0);
+      #endif
+    }
+
+    assert(arena.resize(128) && arena.size() == 128);
+  }
+
   // ------------------------------------------------------------------
   // 500 alloc/reset cycles
   // ------------------------------------------------------------------
@@ -223,4 +308,753 @@ int main() {
       arena.size() > (10 + (sizeof(int) * 3) * 2)
     );
   }
+
+  // ------------------------------------------------------------------
+  // Current page cursor + best-fit 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    char* a = arena.allocate_size<char>(60);
+    char* b = arena.allocate_size<char>(100); // Does not fit, grows.
+
+    assert(
+      a && b &&
+      arena.size() == 64 + 128 &&
+      arena.used() == 160
+    );
+
+    // 4 bytes are left on the first page, but the cursor stays on the
+    // second page by default.
+    char* c = arena.allocate_size<char>(4);
+    assert(c == b + 100 && arena.used() == 164);
+
+    arena.best_fit(true);
+
+    // With best-fit enabled, the tail of the first page is reused once
+    // the current page runs out.
+    char* d = arena.allocate_size<char>(24);
+    char* e = arena.allocate_size<char>(4);
+
+    assert(
+      d == c + 4 &&
+      e == a + 60 &&
+      arena.used() == 192 &&
+      arena.size() == 64 + 128
+    );
+
+    // Reset moves the cursor back to the first page, and later pages
+    // are reused before growing again.
+    arena.reset();
+
+    char* f = arena.allocate_size<char>(60);
+    char* g = arena.allocate_size<char>(100);
+
+    assert(
+      f == a &&
+      g == b &&
+      arena.size() == 64 + 128
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Mark/rewind + scoped savepoints 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    int* keep = arena.allocate_new<int>(7);
+    apc::arena_mark mark = arena.mark();
+
+    arena.allocate_size<char>(40);
+    arena.allocate_size<char>(100); // Grows to a second page.
+
+    assert(arena.used() > 100 && arena.size() > 64);
+
+    arena.rewind(mark);
+
+    assert(
+      *keep == 7 &&
+      arena.used() == sizeof(int) &&
+      arena.allocate_new<int>(8) == keep + 1
+    );
+
+    {
+      apc::arena_scope scope(arena);
+
+      char* scratch = arena.allocate_size<char>(300);
+      strcpy(scratch, "scratch");
+
+      assert(arena.used() > 300);
+    }
+
+    assert(arena.used() == sizeof(int) * 2);
+
+    // Nested scopes rewind in order.
+    {
+      apc::arena_scope outer(arena);
+      arena.allocate_size<char>(10);
+
+      {
+        apc::arena_scope inner(arena);
+        arena.allocate_size<char>(20);
+
+        assert(arena.used() == (sizeof(int) * 2) + 30);
+      }
+
+      assert(arena.used() == (sizeof(int) * 2) + 10);
+    }
+
+    assert(arena.used() == sizeof(int) * 2);
+
+    // A mark taken on an empty arena rewinds everything.
+    apc::arena empty(0);
+    apc::arena_mark empty_mark = empty.mark();
+    empty.allocate_size<char>(20);
+    empty.rewind(empty_mark);
+
+    assert(empty.used() == 0);
+  }
+
+  // ------------------------------------------------------------------
+  // Virtual memory reserve + lazy commit 
+  // ------------------------------------------------------------------
+  #ifdef APC_ARENA_VIRTUAL
+  {
+    const size_t one_gib = 1024ULL * 1024 * 1024;
+    apc::arena arena(0);
+
+    assert(arena.reserve(one_gib));
+    assert(
+      arena.reserved_size() == one_gib &&
+      arena.size() == 0 &&
+      arena.used() == 0
+    );
+
+    char* a = arena.allocate_size<char>(100);
+    strcpy(a, "Hello");
+
+    // Only a single OS page is committed.
+    assert(arena.size() > 0 && arena.size() < one_gib);
+
+    // A big allocation commits more, but stays contiguous.
+    char* b = arena.allocate_size<char>(10 * 1024 * 1024);
+    b[10 * 1024 * 1024 - 1] = 'x';
+
+    assert(
+      b == a + 100 &&
+      arena.size() >= 100 + (10 * 1024 * 1024) &&
+      arena.used() == 100 + (10 * 1024 * 1024)
+    );
+
+    // Can not grow past the reservation.
+    assert(arena.allocate_size<char>(one_gib) == nullptr);
+
+    size_t committed = arena.size();
+
+    arena.reset();
+
+    assert(
+      arena.used() == 0 &&
+      arena.size() == committed &&
+      arena.allocate_size<char>(100) == a
+    );
+
+    // Resize leaves virtual memory mode.
+    assert(arena.resize(64));
+    assert(arena.reserved_size() == 0 && arena.size() == 64);
+
+    // Not supported for child arenas.
+    apc::arena child(arena, 16);
+    assert(!child.reserve(1024));
+  }
+  #endif
+
+  // ------------------------------------------------------------------
+  // Huge pages + prefault 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1000, apc::page_huge | apc::page_prefault);
+
+    // Huge pages round the page up, and the extra space is usable.
+    assert(arena.size() >= 1000 && arena.used() == 0);
+
+    char* a = arena.allocate_size<char>(100);
+    strcpy(a, "Hello");
+
+    // Grown pages use the same flags.
+    char* b = arena.allocate_size<char>(arena.size());
+    b[0] = 'x';
+
+    assert(
+      strcmp(a, "Hello") == 0 &&
+      arena.size() >= 1000 * 3
+    );
+
+    apc::arena prefaulted(1000, apc::page_prefault);
+    assert(prefaulted.size() >= 1000 && prefaulted.allocate_size<char>(1000));
+
+    #ifdef APC_ARENA_VIRTUAL
+    apc::arena reserved(0, apc::page_huge | apc::page_prefault);
+    assert(reserved.reserve(64 * 1024 * 1024, 1024));
+    assert(reserved.size() >= 1024 && reserved.allocate_size<char>(4096));
+    #endif
+  }
+
+  // ------------------------------------------------------------------
+  // Reset policies: trim + consolidate 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    // Spike: grow to 64 + 128 + 256 + 512.
+    arena.allocate_size<char>(60);
+    arena.allocate_size<char>(120);
+    arena.allocate_size<char>(250);
+    arena.allocate_size<char>(500);
+
+    assert(arena.size() == 64 + 128 + 256 + 512);
+
+    // Keep the pages that fit in 200 bytes.
+    arena.reset(apc::arena_reset_trim, 200);
+
+    assert(
+      arena.size() == 64 + 128 &&
+      arena.used() == 0 &&
+      arena.reset_stats().trims == 1 &&
+      arena.reset_stats().pages_released == 2 &&
+      arena.reset_stats().bytes_released >= 256 + 512 &&
+      arena.reset_stats().high_water == 930
+    );
+
+    // The arena is still usable and grows again.
+    char* a = arena.allocate_size<char>(60);
+    char* b = arena.allocate_size<char>(120);
+    char* c = arena.allocate_size<char>(250);
+    strcpy(c, "grown");
+
+    assert(a && b && strcmp(c, "grown") == 0 && arena.size() == 64 + 128 + 256);
+
+    // The first page is always kept.
+    arena.reset(apc::arena_reset_trim, 0);
+    assert(arena.size() == 64 && arena.reset_stats().trims == 2);
+
+    // Consolidate into one page sized to the high-water mark.
+    arena.allocate_size<char>(60);
+    arena.allocate_size<char>(100);
+    arena.allocate_size<char>(200);
+
+    assert(arena.size() == 64 + 128 + 256);
+
+    arena.reset(apc::arena_reset_consolidate);
+
+    const size_t consolidated = arena.size();
+
+    assert(
+      consolidated >= 930 &&
+      arena.used() == 0 &&
+      arena.reset_stats().consolidations == 1 &&
+      arena.reset_stats().high_water == 0
+    );
+
+    char* d = arena.allocate_size<char>(60);
+    char* e = arena.allocate_size<char>(100);
+    char* f = arena.allocate_size<char>(200);
+
+    // One contiguous block, no growing.
+    assert(e == d + 60 && f == e + 100 && arena.size() == consolidated);
+
+    // Keep policy, same as reset().
+    arena.reset(apc::arena_reset_keep);
+    assert(arena.size() == consolidated && arena.used() == 0);
+
+    // Child arenas only reset, and give the pages they grew
+    // back to the parent.
+    apc::arena child(arena, 16);
+    child.allocate_size<char>(100);
+    child.reset(apc::arena_reset_trim);
+    assert(child.used() == 0 && child.size() == 16);
+
+    // While a child is alive the parent only resets, the child may still
+    // be using the pages.
+    arena.allocate_size<char>(consolidated);
+    const size_t grown = arena.size();
+    assert(grown > consolidated);
+
+    arena.reset(apc::arena_reset_trim, 0);
+    assert(arena.size() == grown && arena.used() == 0);
+
+    arena.reset(apc::arena_reset_consolidate);
+    assert(arena.size() == grown && arena.used() == 0);
+
+    #ifdef APC_ARENA_VIRTUAL
+    apc::arena reserved(0);
+    reserved.reserve(64 * 1024 * 1024);
+    reserved.allocate_size<char>(8 * 1024 * 1024);
+
+    assert(reserved.size() >= 8 * 1024 * 1024);
+
+    reserved.reset(apc::arena_reset_trim, 4096);
+
+    assert(
+      reserved.size() == 4096 &&
+      reserved.reset_stats().bytes_released > 0 &&
+      reserved.allocate_size<char>(8 * 1024 * 1024)
+    );
+    #endif
+  }
+
+  // ------------------------------------------------------------------
+  // Finalizers for non-trivially destructible types 
+  // ------------------------------------------------------------------
+  {
+    {
+      apc::arena arena(1024);
+
+      // Trivial types take the plain path, nothing is registered.
+      int* num = arena.allocate_new_finalized<int>(5);
+      assert(*num == 5 && arena.used() == sizeof(int));
+
+      arena.allocate_new_finalized<Finalized>(1);
+      arena.allocate_new_finalized<Finalized>(2);
+
+      // Destructors run in reverse order on reset.
+      arena.reset();
+      assert(Finalized::destroyed == 21);
+
+      // And when rewinding past them.
+      Finalized::destroyed = 0;
+      arena.allocate_new_finalized<Finalized>(3);
+      apc::arena_mark mark = arena.mark();
+      arena.allocate_new_finalized<Finalized>(4);
+      arena.allocate_new_finalized<Finalized>(5);
+      arena.rewind(mark);
+      assert(Finalized::destroyed == 54);
+
+      {
+        apc::arena_scope scope(arena);
+        arena.allocate_new_finalized<Finalized>(6);
+      }
+      assert(Finalized::destroyed == 546);
+
+      // Heap owning values no longer leak (checked by asan).
+      apc::str* str = arena.allocate_new_finalized<apc::str>(
+        "A string that is longer than the static buffer of 32 chars"
+      );
+      std::string* std_str = arena.allocate_new_finalized<std::string>(
+        "Another string that is long enough to allocate on the heap"
+      );
+      assert(str->used() > 32 && std_str->size() > 32);
+
+      Finalized::destroyed = 0;
+    }
+
+    // The rest run when the arena is destroyed.
+    assert(Finalized::destroyed == 3);
+
+    // No room for the finalizer: the object is destroyed and taken back.
+    {
+      apc::arena full(sizeof(Finalized));
+      apc::growth_policy limit;
+      limit.max_size = sizeof(Finalized);
+      full.growth(limit);
+
+      Finalized::destroyed = 0;
+
+      assert(!full.allocate_new_finalized<Finalized>(7));
+      assert(Finalized::destroyed == 7 && full.used() == 0);
+    }
+
+    assert(Finalized::destroyed == 7);
+  }
+
+  // ------------------------------------------------------------------
+  // Dedicated large pages 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+    arena.large_pages(4096);
+
+    char* a = arena.allocate_size<char>(1000);
+
+    // Too big for the current page, gets its own exact-size page instead
+    // of growing the arena to 2048, 4096, ...
+    char* big = arena.allocate_size<char>(100000);
+    big[99999] = 'x';
+
+    assert(
+      a && big &&
+      arena.size() >= 1024 + 100000 &&
+      arena.size() < 1024 + 100000 + 64 &&
+      arena.used() == 1000 + 100000
+    );
+
+    // Normal allocations keep using the geometric pages.
+    arena.allocate_size<char>(100);
+    assert(arena.size() >= 1024 + 2048 + 100000 && arena.size() < 1024 + 2048 + 100000 + 64);
+
+    // Large allocations that fit on the current page just bump.
+    char* fits = arena.allocate_size<char>(1900 - 100);
+    assert(fits && arena.size() < 1024 + 2048 + 100000 + 64);
+
+    // Rewind frees large pages allocated after the mark.
+    apc::arena_mark mark = arena.mark();
+    arena.allocate_size<char>(50000);
+    assert(arena.size() >= 1024 + 2048 + 150000);
+    arena.rewind(mark);
+    assert(arena.size() < 1024 + 2048 + 100000 + 64);
+
+    arena.reset();
+
+    assert(arena.used() == 0 && arena.size() == 1024 + 2048);
+
+    // Keep large pages for reuse.
+    arena.large_pages(4096, true);
+
+    char* first = arena.allocate_size<char>(8000);
+    arena.reset();
+
+    assert(arena.size() == 1024 + 2048 + 8000 && arena.used() == 0);
+
+    char* second = arena.allocate_size<char>(7000);
+    assert(second == first);
+
+    // Trimming releases the kept large pages.
+    arena.reset(apc::arena_reset_trim, 1 << 20);
+    assert(arena.size() == 1024 + 2048);
+  }
+
+  // ------------------------------------------------------------------
+  // In-place extend + LIFO free of the last allocation 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+
+    char* a = arena.allocate_size<char>(100);
+    char* b = arena.allocate_size<char>(100);
+
+    // Only the last allocation can be extended.
+    assert(!arena.try_extend(a, 100, 200));
+    assert(arena.try_extend(b, 100, 300) && arena.used() == 400);
+
+    // Shrinking gives space back.
+    assert(arena.try_extend(b, 300, 50) && arena.used() == 150);
+
+    // Not beyond the page.
+    assert(!arena.try_extend(b, 50, 2000) && arena.used() == 150);
+
+    assert(!arena.free_last(a, 100));
+    assert(arena.free_last(b, 50) && arena.used() == 100);
+    assert(arena.free_last(a, 100) && arena.used() == 0);
+    assert(arena.allocate_size<char>(10) == a);
+
+    // A failed free_last() does not move the cursor back over empty pages.
+    apc::arena pages(64);
+    char* first = pages.allocate_size<char>(64);
+    char* second = pages.allocate_size<char>(100);
+    assert(pages.free_last(second, 100));
+
+    const size_t page = pages.mark().page;
+    assert(page == 1);
+    assert(!pages.free_last(first, 32));
+    assert(pages.mark().page == page);
+
+    #ifdef APC_ARENA_VIRTUAL
+    // Virtual arenas commit more memory to extend in place.
+    apc::arena reserved(0);
+    reserved.reserve(64 * 1024 * 1024);
+
+    char* c = reserved.allocate_size<char>(100);
+    assert(reserved.try_extend(c, 100, 10 * 1024 * 1024));
+    c[10 * 1024 * 1024 - 1] = 'x';
+    #endif
+  }
+
+  // ------------------------------------------------------------------
+  // Arena cache recycles pages between arenas 
+  // ------------------------------------------------------------------
+  {
+    apc::arena_cache cache(1024 * 1024);
+    void* first_page;
+
+    {
+      apc::arena arena(cache, 900);
+
+      // Pages are rounded up to a power of two.
+      assert(arena.size() >= 900 && arena.size() < 1024);
+
+      first_page = arena.allocate_size<char>(10);
+      arena.allocate_size<char>(2000); // Grows.
+
+      assert(cache.misses() == 2 && cache.hits() == 0);
+    }
+
+    assert(cache.cached() == 1024 + 4096);
+
+    {
+      apc::arena arena(cache, 900);
+
+      assert(
+        cache.hits() == 1 &&
+        arena.allocate_size<char>(10) == first_page
+      );
+
+      arena.allocate_size<char>(2000);
+
+      assert(cache.hits() == 2 && cache.cached() == 0);
+    }
+
+    // Pages beyond the limit are freed instead of cached.
+    {
+      apc::arena arena(cache, 2 * 1024 * 1024);
+    }
+
+    assert(cache.cached() == 1024 + 4096);
+
+    cache.clear();
+    assert(cache.cached() == 0);
+
+    apc::arena local(apc::arena_cache::local(), 100);
+    assert(local.allocate_size<char>(100));
+
+    // Cached pages are not aligned beyond max_align_t.
+    assert(!local.page_alignment(4096) && local.page_alignment() == 0);
+    assert(local.page_alignment(alignof(std::max_align_t)));
+  }
+
+  // ------------------------------------------------------------------
+  // Over-aligned allocations and page alignment
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1000, apc::page_default, 64);
+
+    assert(arena.page_alignment() == 64);
+
+    // The first allocation on a page needs no padding.
+    float* floats = arena.allocate_aligned<float, 64>(16);
+    assert(
+      reinterpret_cast<uintptr_t>(floats) % 64 == 0 &&
+      arena.used() == sizeof(float) * 16
+    );
+
+    char* byte = arena.allocate_size<char>();
+    double* doubles = arena.allocate_aligned<double, 64>(4);
+    assert(
+      byte &&
+      reinterpret_cast<uintptr_t>(doubles) % 64 == 0 &&
+      arena.used() == 128 + sizeof(double) * 4
+    );
+
+    // Pages added by growing are aligned too.
+    char* big = arena.allocate_aligned<char, 64>(2000);
+    assert(
+      reinterpret_cast<uintptr_t>(big) % 64 == 0 &&
+      arena.size() >= 3000
+    );
+
+    // Alignment is never lowered below alignof(T).
+    arena.allocate_size<char>();
+    uint64_t* words = arena.allocate_aligned<uint64_t, 1>(2);
+    assert(reinterpret_cast<uintptr_t>(words) % alignof(uint64_t) == 0);
+
+    arena.page_alignment(4096);
+
+    // 4 KiB alignment for O_DIRECT buffers.
+    char* block = arena.allocate_aligned<char, 4096>(4096 * 4);
+    assert(reinterpret_cast<uintptr_t>(block) % 4096 == 0);
+
+    arena.reset(apc::arena_reset_trim);
+    assert(arena.used() == 0);
+
+    // Child arenas take aligned pages from their parent.
+    apc::arena child(arena, 256, 64);
+    char* first = child.allocate_size<char>(1);
+    assert(reinterpret_cast<uintptr_t>(first) % 64 == 0);
+  }
+
+  // ------------------------------------------------------------------
+  // Growth policies
+  // ------------------------------------------------------------------
+  {
+    apc::growth_policy policy = apc::growth_policy::geometric(3, 2);
+    assert(policy.next(1000, 1001, 0) == 1500);
+
+    // Growing by 1.5x instead of doubling the last page.
+    apc::arena geometric(1000);
+    geometric.growth(policy);
+    geometric.allocate_size<char>(1000);
+    geometric.allocate_size<char>(100);
+    assert(geometric.size() == 1500);
+
+    // Fixed chunks.
+    apc::arena fixed(64);
+    fixed.growth(apc::growth_policy::fixed(256));
+
+    for(int i = 0; i < 6; i++)
+      fixed.allocate_size<char>(64);
+
+    assert(fixed.size() == 64 + 256 * 2);
+
+    // Fixed chunks still fit bigger allocations.
+    fixed.allocate_size<char>(1000);
+    assert(fixed.size() >= 64 + 256 * 2 + 1000);
+
+    // Capped geometric growth of a big arena.
+    apc::arena capped(1024 * 1024);
+    capped.growth(apc::growth_policy::capped(64 * 1024));
+    capped.allocate_size<char>(1024 * 1024);
+    capped.allocate_size<char>(1);
+    assert(capped.size() == 1024 * 1024 + 64 * 1024);
+
+    // A hard limit makes allocations fail instead of growing past it.
+    apc::arena limited(256);
+    limited.growth(apc::growth_policy().limit(1024));
+
+    assert(limited.allocate_size<char>(256));
+    assert(limited.allocate_size<char>(512));
+    assert(limited.size() <= 1024);
+    assert(!limited.allocate_size<char>(512));
+
+    limited.large_pages(128);
+    assert(!limited.allocate_size<char>(900));
+
+    // Large pages do not inflate the growth of the normal pages.
+    apc::arena large(1024);
+    large.growth(apc::growth_policy::geometric(2));
+    large.large_pages(4096);
+    large.allocate_size<char>(64 * 1024);
+    large.allocate_size<char>(1024);
+
+    const size_t before = large.size();
+    large.allocate_size<char>(1);
+    assert(large.size() == before + 1024);
+  }
+
+  // ------------------------------------------------------------------
+  // Batch allocations
+  // ------------------------------------------------------------------
+  {
+    struct Node {
+      int value;
+      Node* left;
+      Node* right;
+
+      Node(int _value) : value(_value), left(nullptr), right(nullptr) { }
+    };
+
+    apc::arena arena(4096);
+
+    Node* nodes = arena.allocate_new_n<Node>(10, 7);
+    assert(nodes[0].value == 7 && nodes[9].value == 7 && !nodes[9].left);
+    assert(arena.used() == sizeof(Node) * 10);
+
+    arena.reset();
+
+    // Heterogeneous objects in one bump, each correctly aligned.
+    arena.allocate_size<char>();
+
+    std::tuple<char*, double*, Node*> batch =
+      arena.allocate_batch<char, double, Node>({ 3, 2, 4 });
+
+    char* chars = std::get<0>(batch);
+    double* doubles = std::get<1>(batch);
+    Node* children = std::get<2>(batch);
+
+    assert(
+      reinterpret_cast<uintptr_t>(chars) % alignof(double) == 0 &&
+      reinterpret_cast<char*>(doubles) == chars + 8 &&
+      reinterpret_cast<uintptr_t>(children) % alignof(Node) == 0 &&
+      reinterpret_cast<char*>(children) == chars + 8 + sizeof(double) * 2 &&
+      arena.used() == 8 + 8 + sizeof(double) * 2 + sizeof(Node) * 4
+    );
+
+    std::tuple<Node*, int*> single = arena.allocate_batch<Node, int>();
+    assert(
+      reinterpret_cast<char*>(std::get<1>(single)) ==
+        reinterpret_cast<char*>(std::get<0>(single)) + sizeof(Node)
+    );
+
+    // Failure gives nullptr for every type.
+    apc::arena limited(64);
+    limited.growth(apc::growth_policy().limit(64));
+
+    std::tuple<Node*, int*> failed = limited.allocate_batch<Node, int>({ 100, 1 });
+    assert(!std::get<0>(failed) && !std::get<1>(failed));
+
+    // So do sizes that do not fit in a size_t, instead of wrapping around.
+    const size_t half = static_cast<size_t>(-1) / 2 + 1;
+
+    std::tuple<Node*, int*> huge = arena.allocate_batch<Node, int>({ half, 1 });
+    assert(!std::get<0>(huge) && !std::get<1>(huge));
+
+    std::tuple<char*, char*> wrapped = arena.allocate_batch<char, char>({ half, half });
+    assert(!std::get<0>(wrapped) && !std::get<1>(wrapped));
+  }
+
+  // ------------------------------------------------------------------
+  // Prefault and warm-up
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(4096);
+    arena.prefault();
+
+    // Warming more than the free room grows ahead of time.
+    arena.allocate_size<char>(4000);
+    assert(arena.warm(8192) && arena.size() >= 4096 + 8192 && arena.used() == 4000);
+
+    // The next allocation uses the warmed page instead of growing again.
+    const size_t size = arena.size();
+    assert(arena.allocate_size<char>(8000) && arena.size() == size);
+
+    // Already warm enough.
+    assert(arena.warm(16) && arena.size() == size);
+
+    // Warm ahead grows the next page before the current one is full.
+    apc::arena ahead(1024);
+    ahead.warm_ahead(256);
+    assert(ahead.warm_ahead() == 256);
+
+    ahead.allocate_size<char>(512);
+    assert(ahead.size() == 1024);
+
+    ahead.allocate_size<char>(300);
+    assert(ahead.size() == 1024 + 2048 && ahead.used() == 812);
+
+    // The allocation that does not fit moves on to the warmed page.
+    char* next = ahead.allocate_size<char>(500);
+    assert(next && ahead.size() == 1024 + 2048);
+
+    // Once warming ahead failed at the growth limit, later allocations do
+    // not try again, until the growth policy changes.
+    apc::arena capped(1024);
+    apc::growth_policy limit;
+    limit.max_size = 1024 + 4096;
+    capped.growth(limit);
+    capped.large_pages(2048);
+    capped.warm_ahead(256);
+
+    const apc::arena_mark start = capped.mark();
+
+    // A large page takes the room left under the limit.
+    assert(capped.allocate_size<char>(4096));
+    const size_t capped_size = capped.size();
+
+    assert(capped.allocate_size<char>(800) && capped.size() == capped_size);
+
+    // Dropping the large page makes room, but nothing retries.
+    capped.rewind(start);
+    assert(capped.size() == 1024);
+
+    assert(capped.allocate_size<char>(800) && capped.allocate_size<char>(16));
+    assert(capped.size() == 1024);
+
+    capped.growth(limit);
+    assert(capped.allocate_size<char>(16) && capped.size() == 1024 + 2048);
+
+    #ifdef APC_ARENA_VIRTUAL
+    apc::arena reserved(0);
+    reserved.reserve(64 * 1024 * 1024);
+    assert(reserved.warm(1024 * 1024) && reserved.size() >= 1024 * 1024);
+    #endif
+  }
 }
@@ -0,0 +1,92 @@
+// COMPILE: g++ -std=c++11 -Wall -pthread -fsanitize=thread tests_arena_concurrent.cpp
+
+#include "../src/arena_concurrent.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+  std::cout << "Running concurrent Arena tests...\n";
+
+  // ------------------------------------------------------------------
+  // Single thread basics
+  // ------------------------------------------------------------------
+  {
+    apc::arena_concurrent arena(1024, 256);
+
+    assert(arena.size() == 1024 && arena.used() == 0);
+
+    int* a = arena.allocate_new<int>(111);
+
+    assert(*a == 111 && arena.used() == alignof(std::max_align_t));
+
+    apc::arena_concurrent_local local(arena);
+
+    int* b = local.allocate_new<int>(222);
+    int* c = local.allocate_new<int>(333);
+
+    // The local grabbed a whole chunk, then bumped inside it.
+    assert(
+      *b == 222 && *c == 333 &&
+      c == b + 1 &&
+      arena.used() == alignof(std::max_align_t) + 256
+    );
+
+    // Large requests bypass the chunk.
+    char* big = local.allocate_size<char>(2000);
+    assert(big && arena.size() > 1024);
+
+    void* aligned = local.allocate_raw(8, 64);
+    assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+
+    arena.reset();
+
+    assert(arena.used() == 0);
+
+    // The local notices the reset and grabs a fresh chunk.
+    int* d = local.allocate_new<int>(444);
+    assert(*d == 444 && arena.used() == 256);
+  }
+
+  // ------------------------------------------------------------------
+  // Many threads, no overlapping allocations
+  // ------------------------------------------------------------------
+  {
+    const size_t threads_count = 8;
+    const size_t N = 20000;
+
+    apc::arena_concurrent arena(4096, 1024);
+    std::vector<std::thread> threads;
+    std::vector<size_t*> results[threads_count];
+
+    for(size_t t = 0; t < threads_count; t++) {
+      threads.emplace_back([&arena, &results, t, N]() {
+        apc::arena_concurrent_local local(arena);
+
+        for(size_t i = 0; i < N; i++) {
+          size_t* item = (i % 2) ?
+            local.allocate_new<size_t>(t * N + i) :
+            arena.allocate_new<size_t>(t * N + i);
+
+          results[t].push_back(item);
+        }
+      });
+    }
+
+    for(auto &thread : threads) thread.join();
+
+    for(size_t t = 0; t < threads_count; t++) {
+      assert(results[t].size() == N);
+
+      for(size_t i = 0; i < N; i++)
+        assert(*results[t][i] == t * N + i);
+    }
+
+    assert(arena.used() >= sizeof(size_t) * N * threads_count);
+
+    arena.reset();
+
+    assert(arena.used() == 0);
+  }
+}
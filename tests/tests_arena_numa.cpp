@@ -0,0 +1,88 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_arena_numa.cpp
+
+#include "../src/arena_numa.h"
+#include "../src/pool.h"
+#include <cassert>
+#include <iostream>
+
+// The node the OS page at `ptr` was placed on, or -1 if unknown.
+static int node_of(void* ptr) {
+  #if defined(__linux__) && defined(SYS_get_mempolicy)
+  int node = -1;
+
+  // 3 is MPOL_F_NODE | MPOL_F_ADDR.
+  if(syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, 3) == 0) return node;
+  #else
+  (void)ptr;
+  #endif
+
+  return -1;
+}
+
+int main() {
+  std::cout << "Running Arena NUMA tests...\n";
+
+  const size_t nodes = apc::page_numa_nodes();
+  const unsigned last = static_cast<unsigned>(nodes - 1);
+
+  // ------------------------------------------------------------------
+  // Node flags
+  // ------------------------------------------------------------------
+  {
+    assert(nodes >= 1 && apc::page_current_node() < nodes);
+
+    assert(
+      apc::page_flags_node(apc::page_node(3) | apc::page_prefault) == 3 &&
+      apc::page_flags_node(apc::page_prefault) == -1
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Arena and pool pages on a node
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64 * 1024, apc::page_node(last) | apc::page_prefault);
+
+    char* first = arena.allocate_size<char>(1000);
+    assert(first);
+
+    const int node = node_of(first);
+    assert(node == -1 || node == static_cast<int>(last));
+
+    // Grown pages are on the same node.
+    char* grown = arena.allocate_size<char>(128 * 1024);
+    grown[0] = 1;
+    assert(grown && arena.size() > 128 * 1024);
+
+    const int grown_node = node_of(grown);
+    assert(grown_node == -1 || grown_node == static_cast<int>(last));
+
+    apc::pool<int> pool(1000, apc::page_node(last));
+
+    for(int i = 0; i < 5000; i++) assert(pool.allocate_new(i));
+
+    assert(pool.used() == 5000);
+
+    #ifdef APC_ARENA_VIRTUAL
+    apc::arena reserved(0, apc::page_node(last));
+    assert(reserved.reserve(16 * 1024 * 1024) && reserved.allocate_size<char>(1024 * 1024));
+    #endif
+  }
+
+  // ------------------------------------------------------------------
+  // Per-node arena set
+  // ------------------------------------------------------------------
+  {
+    apc::arena_numa set(4096);
+
+    assert(set.nodes() == nodes && set.size() >= 4096 * nodes);
+
+    int* value = set.local().allocate_new<int>(5);
+    assert(*value == 5 && set.used() == sizeof(int));
+
+    assert(&set.node(nodes) == &set.node(0));
+
+    set.reset();
+    assert(set.used() == 0);
+  }
+}
@@ -0,0 +1,134 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_arena_shared.cpp
+
+#include "../src/arena_shared.h"
+#include "../src/vector.h"
+#include "../src/string.h"
+#include <cassert>
+#include <iostream>
+#include <sys/wait.h>
+
+struct Message {
+  apc::offset_array<char> name;
+  apc::offset_array<int> values;
+};
+
+// Copy the contents of an apc::str and an apc::vector into the shared arena.
+static Message* build(apc::arena_shared &shared, const apc::str &name,
+  const apc::vector<int> &values
+) {
+  Message* message = shared.allocate_new<Message>();
+
+  if(!message ||
+    !message->name.assign(shared, name.c_str(), name.used()) ||
+    !message->values.assign(shared, values.first(), values.used())
+  ) return nullptr;
+
+  return message;
+}
+
+static bool check(const Message* message) {
+  if(!message) return false;
+
+  int sum = 0;
+
+  for(int value : message->values) sum += value;
+
+  return message->name.size() == 5 &&
+    memcmp(message->name.data(), "hello", 5) == 0 &&
+    message->values.size() == 100 &&
+    sum == 4950;
+}
+
+int main() {
+  std::cout << "Running Arena shared tests...\n";
+
+  apc::str name("hello");
+  apc::vector<int> values(100);
+
+  for(int i = 0; i < 100; i++) values.push(i);
+
+  // ------------------------------------------------------------------
+  // Allocations from a fork()ed child are visible to the parent
+  // ------------------------------------------------------------------
+  {
+    apc::arena_shared shared(64 * 1024);
+
+    if(!shared.valid()) {
+      std::cout << "memfd_create not supported, skipping.\n";
+
+      return 0;
+    }
+
+    assert(shared.size() >= 64 * 1024 && shared.used() == 0 && !shared.root<Message>());
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+
+    if(pid == 0) {
+      // Both processes allocate at the same time.
+      int* numbers = shared.allocate_size<int>(1000);
+
+      for(int i = 0; i < 1000; i++) numbers[i] = i;
+
+      Message* message = build(shared, name, values);
+      shared.set_root(message);
+
+      _exit(check(message) ? 0 : 1);
+    }
+
+    int* mine = shared.allocate_size<int>(1000);
+
+    for(int i = 0; i < 1000; i++) mine[i] = -i;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    assert(check(shared.root<Message>()));
+
+    // The allocations did not overlap.
+    for(int i = 0; i < 1000; i++) assert(mine[i] == -i);
+
+    assert(shared.used() >= sizeof(int) * 2000 + sizeof(Message) + 5 + sizeof(int) * 100);
+
+    const size_t offset = shared.offset_of(mine);
+    assert(shared.at<int>(offset) == mine);
+
+    // Full regions fail instead of growing.
+    assert(!shared.allocate_size<char>(shared.size()));
+
+    shared.reset();
+    assert(shared.used() == 0 && !shared.root<Message>());
+  }
+
+  // ------------------------------------------------------------------
+  // Named regions, mapped twice at different addresses
+  // ------------------------------------------------------------------
+  {
+    char region[64];
+    snprintf(region, sizeof(region), "/apc_arena_shared_%d", static_cast<int>(getpid()));
+
+    apc::arena_shared producer(region, 16 * 1024);
+    assert(producer.valid());
+
+    producer.set_root(build(producer, name, values));
+
+    apc::arena_shared consumer(region);
+    assert(consumer.valid() && consumer.size() == producer.size());
+
+    const Message* message = consumer.root<Message>();
+    assert(
+      reinterpret_cast<const void*>(message) != reinterpret_cast<const void*>(producer.root<Message>()) &&
+      check(message)
+    );
+
+    // Allocations from either side share the bump pointer.
+    char* a = consumer.allocate_size<char>(10);
+    assert(producer.used() == consumer.used() && consumer.offset_of(a) + 10 == producer.used());
+
+    assert(apc::arena_shared::unlink(region));
+
+    apc::arena_shared missing(region);
+    assert(!missing.valid() && !missing.allocate_size<char>(1));
+  }
+}
@@ -0,0 +1,136 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_arena_stats.cpp
+
+#define APC_ARENA_STATS 1
+
+#include "../src/arena.h"
+#include <cassert>
+#include <iostream>
+
+int main() {
+  std::cout << "Running Arena stats tests...\n";
+
+  // ------------------------------------------------------------------
+  // Requested bytes, padding and peak
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    arena.allocate_raw(1, 1);
+    arena.allocate_raw(8, 8); // 7 bytes of padding.
+    arena.allocate_raw(3, 1);
+
+    apc::arena_stats stats = arena.stats();
+
+    assert(
+      stats.allocations == 3 &&
+      stats.requested == 12 &&
+      stats.padding == 7 &&
+      stats.tail_waste == 0 &&
+      stats.pages == 1 &&
+      stats.peak == 19 &&
+      arena.used() == 19
+    );
+
+    arena.reset();
+    arena.allocate_raw(4, 1);
+
+    stats = arena.stats();
+
+    // Counters add up across resets, the peak is the highest in use.
+    assert(
+      stats.allocations == 4 &&
+      stats.requested == 16 &&
+      stats.peak == 19
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Tail waste when the arena moves to a new page
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    arena.allocate_raw(60, 1);
+    arena.allocate_raw(100, 1); // 4 bytes left on the first page.
+
+    apc::arena_stats stats = arena.stats();
+
+    assert(
+      stats.tail_waste == 4 &&
+      stats.pages == 2 &&
+      stats.peak == 160
+    );
+
+    apc::arena_mark mark = arena.mark();
+    arena.allocate_raw(20, 1);
+    arena.rewind(mark);
+    arena.allocate_raw(10, 1);
+
+    assert(arena.stats().peak == 180);
+
+    arena.clear_stats();
+
+    stats = arena.stats();
+
+    assert(
+      stats.allocations == 0 &&
+      stats.tail_waste == 0 &&
+      stats.pages == 2 &&
+      stats.peak == 0
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Per-tag counters
+  // ------------------------------------------------------------------
+  {
+    enum { tag_parser = 1, tag_strings = 2 };
+
+    apc::arena arena(1024);
+
+    arena.allocate_raw(100, 8, tag_parser);
+    arena.allocate_raw(50, 8, tag_parser);
+    arena.allocate_raw(30, 1, tag_strings);
+    arena.allocate_size<int>(2); // Untagged (tag 0).
+
+    // Out of range tags are ignored.
+    arena.allocate_raw(1, 1, APC_ARENA_STATS_TAGS);
+
+    apc::arena_stats stats = arena.stats();
+
+    assert(
+      stats.tags[tag_parser] == 150 &&
+      stats.tags[tag_strings] == 30 &&
+      stats.tags[0] == sizeof(int) * 2 &&
+      stats.requested == 150 + 30 + sizeof(int) * 2 + 1
+    );
+
+    // Failed allocations are not counted.
+    apc::arena limited(64);
+    limited.growth(apc::growth_policy().limit(64));
+
+    assert(!limited.allocate_raw(100, 8, tag_parser));
+    assert(limited.stats().tags[tag_parser] == 0);
+  }
+
+  // ------------------------------------------------------------------
+  // free_last() keeps the bytes in use in line with used()
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+
+    arena.allocate_raw(1, 1);
+    void* last = arena.allocate_raw(8, 8); // 7 bytes of padding.
+
+    assert(arena.free_last(last, 8) && arena.used() == 8);
+
+    for(int i = 0; i < 100; i++) {
+      last = arena.allocate_raw(40, 8);
+      assert(arena.free_last(last, 40));
+    }
+
+    arena.allocate_raw(16, 1);
+
+    assert(arena.used() == 24 && arena.stats().peak == 48);
+  }
+}
@@ -0,0 +1,216 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_compact.cpp
+
+#include "../src/compact.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+struct Row {
+  apc::str name;
+  apc::vector<int> values;
+
+  Row() { }
+
+  Row(apc::arena &arena, const char* _name) : name(arena, _name), values(arena, 1) { }
+};
+
+namespace apc {
+
+template <>
+struct compact_traits<Row> {
+  static const bool deep = true;
+
+  static void size(compact_counter &counter, const Row &src) {
+    compact_size(counter, src.name);
+    compact_size(counter, src.values);
+  }
+
+  static bool copy(apc::arena &arena, Row* dst, const Row &src) {
+    new (dst) Row();
+    dst->name.~str();
+    dst->values.~vector();
+
+    return compact_copy(arena, &dst->name, src.name) &&
+      compact_copy(arena, &dst->values, src.values);
+  }
+};
+
+}
+
+static const char* long_name(const int i) {
+  static char buffer[128];
+
+  snprintf(buffer, sizeof(buffer), "a name which is too long for the static buffer %d", i);
+
+  return buffer;
+}
+
+int main() {
+  std::cout << "Running Compact tests...\n";
+
+  // ------------------------------------------------------------------
+  // vector of trivial items
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+    apc::vector<int> values(arena, 1);
+
+    for(int i = 0; i < 1000; i++) values.push(i);
+
+    const size_t size = apc::compact_size(values);
+    assert(size == sizeof(values) + sizeof(int) * 1000);
+
+    apc::arena packed(size);
+    apc::vector<int>* copy = apc::compact(packed, values);
+
+    assert(copy && copy->used() == 1000 && copy->size() == 1000);
+    assert(copy->arena() == &packed);
+
+    for(int i = 0; i < 1000; i++) assert((*copy)[i] == i);
+
+    // Exactly one full page.
+    assert(packed.data() != nullptr);
+    assert(packed.used() == packed.size() && packed.size() == size);
+  }
+
+  // ------------------------------------------------------------------
+  // Nested containers, the old arena can be dropped
+  // ------------------------------------------------------------------
+  {
+    apc::arena* packed = nullptr;
+    apc::vector<Row>* rows = nullptr;
+
+    {
+      apc::arena arena(128);
+      apc::vector<Row> source(arena, 1);
+
+      // Mark/reset cycles leave the arena spread over many pages.
+      for(int i = 0; i < 100; i++) {
+        Row* row = source.push_new(arena, i % 2 ? long_name(i) : "short");
+
+        for(int z = 0; z <= i; z++) row->values.push(z);
+
+        auto mark = arena.mark();
+        arena.allocate_raw(512);
+        arena.rewind(mark);
+      }
+
+      assert(arena.data() == nullptr);
+
+      const size_t size = apc::compact_size(source);
+
+      packed = new apc::arena(size);
+      rows = apc::compact(*packed, source);
+
+      assert(rows);
+      assert(packed->used() == size && packed->size() == size);
+      assert(packed->data() != nullptr);
+    }
+
+    assert(rows->used() == 100);
+
+    for(int i = 0; i < 100; i++) {
+      const Row &row = (*rows)[i];
+
+      assert(row.name == (i % 2 ? long_name(i) : "short"));
+      assert(row.values.used() == static_cast<size_t>(i + 1));
+      assert(row.values.size() == static_cast<size_t>(i + 1));
+      assert(row.values[i] == i);
+
+      assert(packed->contains(row.values.first()));
+
+      if(i % 2) assert(packed->contains(row.name.c_str()));
+    }
+
+    delete packed;
+  }
+
+  // ------------------------------------------------------------------
+  // hashmap
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+    apc::hashmap<apc::str, sizeof(int)> source(arena, 4);
+
+    for(int i = 0; i < 300; i++) {
+      apc::str value(long_name(i));
+      source.insert(value, &i);
+    }
+
+    const size_t size = apc::compact_size(source);
+    apc::arena packed(size);
+    auto* copy = apc::compact(packed, source);
+
+    assert(copy->size() == source.size());
+    assert(copy->items() == 300 && copy->used() == source.used());
+    assert(packed.used() == size && packed.size() == size);
+
+    for(int i = 0; i < 300; i++) {
+      apc::str* value = copy->find(&i);
+
+      assert(value && *value == long_name(i));
+      assert(packed.contains(value->c_str()));
+    }
+
+    size_t count = 0;
+    copy->for_each([&count](const void*, const apc::str&) { count++; });
+    assert(count == 300);
+
+    // Values are destroyed with the source, the copy is not destroyed.
+  }
+
+  // ------------------------------------------------------------------
+  // Empty containers take no room
+  // ------------------------------------------------------------------
+  {
+    apc::vector<apc::str> empty;
+
+    assert(apc::compact_size(empty) == sizeof(empty));
+
+    apc::str short_str("short");
+
+    assert(apc::compact_size(short_str) == sizeof(short_str));
+
+    apc::arena packed(apc::compact_size(short_str));
+    apc::str* copy = apc::compact(packed, short_str);
+
+    assert(*copy == "short" && packed.contains(copy));
+
+    // An empty vector is still bound to the arena, and grows in it.
+    apc::arena arena(64);
+    apc::vector<int> source(arena, 0);
+    apc::vector<int>* empty_copy = apc::compact(arena, source);
+
+    assert(empty_copy && empty_copy->arena() == &arena);
+
+    empty_copy->push(1);
+    assert(arena.contains(empty_copy->first()));
+  }
+
+  // ------------------------------------------------------------------
+  // Running out of room fails the copy
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64);
+    apc::vector<Row> source(arena, 1);
+
+    for(int i = 0; i < 10; i++) {
+      Row* row = source.push_new(arena, long_name(i));
+      row->values.push(i);
+    }
+
+    const size_t size = apc::compact_size(source);
+
+    // Room for half of it, and no growth.
+    apc::arena packed(size / 2);
+    apc::growth_policy limit;
+    limit.max_size = size / 2;
+    packed.growth(limit);
+
+    assert(!apc::compact(packed, source));
+  }
+
+  std::cout << "All tests passed!\n";
+
+  return 0;
+}
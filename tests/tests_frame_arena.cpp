@@ -0,0 +1,82 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_frame_arena.cpp
+
+#include "../src/frame_arena.h"
+#include <cassert>
+#include <iostream>
+
+int main() {
+  std::cout << "Running Frame arena tests...\n";
+
+  // ------------------------------------------------------------------
+  // Generations live for K frames
+  // ------------------------------------------------------------------
+  {
+    apc::frame_arena<3> frames(1024);
+
+    int* frame0 = frames.allocate_new<int>(0);
+    assert(frames.generation() == 0 && frames.generation_of(frame0) == 0);
+
+    frames.advance();
+    int* frame1 = frames.allocate_new<int>(1);
+    frames.allocate_size<char>(100);
+
+    frames.advance();
+    int* frame2 = frames.allocate_new<int>(2);
+
+    // Frame 0 is still alive in frame 2.
+    assert(
+      *frame0 == 0 && *frame1 == 1 && *frame2 == 2 &&
+      frames.generation_of(frame0) == 0 &&
+      frames.generation_of(frame1) == 1 &&
+      frames.generation_of(frame2) == 2 &&
+      frames.get(0) && frames.get(2) == &frames.current()
+    );
+
+    assert(
+      frames.stats(1).generation == 1 &&
+      frames.stats(1).used == sizeof(int) + 100 &&
+      frames.stats(1).size == 1024
+    );
+
+    // Frame 3 reuses the arena of frame 0.
+    frames.advance();
+
+    assert(
+      frames.generation() == 3 &&
+      !frames.get(0) &&
+      frames.generation_of(frame0) == -1 &&
+      frames.generation_of(frame1) == 1 &&
+      frames.retired().generation == 0 &&
+      frames.retired().used == sizeof(int)
+    );
+
+    int* frame3 = frames.allocate_new<int>(3);
+    assert(frame3 == frame0 && frames.generation_of(frame3) == 3);
+
+    int outside = 0;
+    assert(frames.generation_of(&outside) == -1);
+
+    assert(frames.high_water() == sizeof(int) + 100);
+    assert(frames.size() == 1024 * 3 && frames.used() == sizeof(int) * 3 + 100);
+  }
+
+  // ------------------------------------------------------------------
+  // Many frames
+  // ------------------------------------------------------------------
+  {
+    apc::frame_arena<2> frames(64);
+
+    for(size_t i = 0; i < 1000; i++) {
+      char* data = frames.allocate_size<char>(100 + i % 50);
+      assert(data && frames.generation_of(data) == static_cast<long>(i));
+
+      frames.advance();
+    }
+
+    assert(
+      frames.generation() == 1000 &&
+      frames.retired().generation == 998 &&
+      frames.high_water() == 149
+    );
+  }
+}
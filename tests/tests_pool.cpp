@@ -4,6 +4,7 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "../src/arena.h"
 #include "../src/pool.h"
 
@@ -246,4 +247,213 @@ int main() {
 
     assert(pool.used() == 2);
   }
+
+  // ------------------------------------------------------------------
+  // Huge pages + prefault 
+  // ------------------------------------------------------------------
+  {
+    apc::pool<int> pool(1000, apc::page_huge | apc::page_prefault);
+    assert(pool.size() == 1000 && pool.flags() == (apc::page_huge | apc::page_prefault));
+
+    int* a = pool.allocate_new(1);
+    assert(a && *a == 1);
+
+    // Grown pages use the same flags.
+    for(int i = 0; i < 2000; i++) pool.allocate_new(i);
+
+    assert(pool.size() > 2000 && pool.used() == 2001);
+
+    apc::pool<int> prefaulted(100, apc::page_prefault);
+    assert(prefaulted.allocate_new(5) && prefaulted.size() == 100);
+  }
+
+  // ------------------------------------------------------------------
+  // Growth policies
+  // ------------------------------------------------------------------
+  {
+    apc::pool<int> pool(4);
+    pool.growth(apc::growth_policy::fixed(sizeof(apc::pool_item<int>) * 4));
+
+    for(int i = 0; i < 12; i++) pool.allocate_new(i);
+
+    assert(pool.size() == 12 && pool.used() == 12);
+
+    apc::pool<int> limited(4);
+    limited.growth(apc::growth_policy().limit(sizeof(apc::pool_item<int>) * 10));
+
+    for(int i = 0; i < 10; i++) assert(limited.allocate_new(i));
+
+    assert(limited.size() == 10 && !limited.allocate_new(10));
+  }
+
+  // ------------------------------------------------------------------
+  // Prefault and warm-up
+  // ------------------------------------------------------------------
+  {
+    apc::pool<int> pool(10);
+    pool.prefault();
+
+    for(int i = 0; i < 8; i++) pool.allocate_new(i);
+
+    assert(pool.warm(100) && pool.size() >= 108 && pool.used() == 8);
+
+    const size_t size = pool.size();
+
+    for(int i = 0; i < 100; i++) pool.allocate_new(i);
+
+    assert(pool.size() == size);
+
+    // Warm ahead grows before the pool is empty.
+    apc::pool<int> ahead(10);
+    ahead.warm_ahead(4);
+
+    for(int i = 0; i < 6; i++) ahead.allocate_new(i);
+
+    assert(ahead.size() == 10);
+
+    ahead.allocate_new(6);
+    assert(ahead.size() == 30 && ahead.used() == 7);
+
+    // Once growing ahead failed the pool still hands out its items, and
+    // tries again after the growth policy changed.
+    apc::pool<int> limited(10);
+    apc::growth_policy limit;
+    limit.max_size = sizeof(apc::pool_item<int>) * 10;
+    limited.growth(limit);
+    limited.warm_ahead(4);
+
+    for(int i = 0; i < 8; i++) assert(limited.allocate_new(i));
+
+    assert(limited.size() == 10 && limited.used() == 8);
+
+    limited.growth(apc::growth_policy());
+    limited.allocate_new(8);
+    assert(limited.size() == 30 && limited.used() == 9);
+  }
+
+  // ------------------------------------------------------------------
+  // Lazy initialization: never used items are handed out in order,
+  // recycled items first, and reset() starts over.
+  // ------------------------------------------------------------------
+  {
+    apc::pool<int> pool(4);
+    int* a = pool.allocate_new(1);
+    int* b = pool.allocate_new(2);
+    int* c = pool.allocate_new(3);
+    assert(b == a + sizeof(apc::pool_item<int>) / sizeof(int));
+
+    pool.deallocate(b);
+    assert(pool.allocate_new(4) == b);
+
+    // The rest of the page, then a new page.
+    int* d = pool.allocate_new(5);
+    assert(d && d != a && d != b && d != c);
+
+    int* e = pool.allocate_new(6);
+    assert(pool.size() == 12 && pool.used() == 5 && *e == 6);
+
+    pool.deallocate(c);
+    pool.reset();
+    assert(pool.used() == 0 && pool.size() == 12);
+
+    // Recycled items are forgotten by reset().
+    assert(pool.allocate_new(7) == a);
+    assert(pool.allocate_new(8) == b);
+
+    for(int i = 0; i < 10; i++) assert(pool.allocate_new(i));
+    assert(pool.size() == 12 && pool.used() == 12);
+
+    apc::pool_compact<int> compact(4);
+    int* f = compact.allocate_new(1);
+    compact.allocate_new(2);
+    compact.reset();
+    assert(compact.allocate_new(3) == f && compact.used() == 1);
+  }
+
+  // ------------------------------------------------------------------
+  // pool_compact
+  // ------------------------------------------------------------------
+  {
+    // The free-list link overlaps the value.
+    static_assert(sizeof(apc::pool_compact_item<int>) == sizeof(void*), "no overhead");
+    static_assert(sizeof(apc::pool_compact_item<double[4]>) == sizeof(double[4]), "no overhead");
+
+    apc::pool_compact<int> pool(2);
+    int* a = pool.allocate_new(1);
+    int* b = pool.allocate_new(2);
+    assert(pool.used() == 2 && pool.size() == 2);
+
+    // Grows when full.
+    int* c = pool.allocate_new(3);
+    assert(c && pool.size() == 6 && pool.used() == 3);
+    assert(*a == 1 && *b == 2 && *c == 3);
+
+    // Freed items are reused first.
+    pool.deallocate(b);
+    assert(pool.used() == 2);
+    assert(pool.allocate_new(4) == b);
+
+    pool.reset();
+    assert(pool.used() == 0 && pool.size() == 6);
+
+    for(int i = 0; i < 6; i++) pool.allocate_new(i);
+    assert(pool.size() == 6);
+
+    // In an arena.
+    apc::arena arena(1024);
+    apc::pool_compact<int> in_arena(arena, 4);
+    int* d = in_arena.allocate_new(5);
+    assert(arena.contains(d) && *d == 5);
+  }
+
+  {
+    // Non-trivial items are destroyed on reset and destruction, found
+    // through the occupancy bitmap.
+    static int destroyed = 0;
+
+    struct Item {
+      std::string name;
+      ~Item() { destroyed++; }
+    };
+
+    {
+      apc::pool_compact<Item> pool(50);
+      std::vector<Item*> items;
+
+      for(int i = 0; i < 100; i++)
+        items.push_back(pool.allocate_new(Item{ std::string(40, 'a' + i % 26) }));
+
+      destroyed = 0;
+
+      for(int i = 0; i < 100; i += 3) pool.deallocate(items[i]);
+
+      assert(destroyed == 34 && pool.used() == 66);
+
+      pool.reset();
+      assert(destroyed == 100 && pool.used() == 0);
+
+      for(int i = 0; i < 70; i++) pool.allocate_new(Item{ std::string(40, 'b') });
+
+      destroyed = 0;
+    }
+
+    assert(destroyed == 70);
+
+    // Many small pages, with free items spread over all of them.
+    {
+      apc::pool_compact<Item> pool(4);
+      pool.growth(apc::growth_policy::fixed(sizeof(apc::pool_compact_item<Item>) * 4));
+      std::vector<Item*> items;
+
+      for(int i = 0; i < 400; i++)
+        items.push_back(pool.allocate_new(Item{ std::string(40, 'c') }));
+
+      for(int i = 0; i < 400; i += 2) pool.deallocate(items[i]);
+
+      destroyed = 0;
+
+      pool.reset();
+      assert(destroyed == 200 && pool.used() == 0);
+    }
+  }
 }
@@ -0,0 +1,121 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_snapshot.cpp
+
+#include "../src/snapshot.h"
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+struct Entry {
+  apc::offset_array<char> name;
+  int value;
+};
+
+struct Table {
+  apc::offset_array<Entry> entries;
+  apc::offset_ptr<Entry> largest;
+};
+
+int main() {
+  std::cout << "Running Snapshot tests...\n";
+
+  // ------------------------------------------------------------------
+  // offset_ptr
+  // ------------------------------------------------------------------
+  {
+    int values[2] = { 1, 2 };
+
+    apc::offset_ptr<int> ptr;
+    assert(!ptr && ptr.get() == nullptr);
+
+    ptr = &values[1];
+    assert(ptr && *ptr == 2 && ptr.get() == &values[1]);
+
+    // Copies point to the same object.
+    apc::offset_ptr<int> copy(ptr);
+    assert(copy.get() == &values[1]);
+
+    copy = nullptr;
+    assert(!copy);
+
+    apc::offset_array<int> array(values, 2);
+    int sum = 0;
+
+    for(int value : array) sum += value;
+
+    assert(array.size() == 2 && array[0] == 1 && sum == 3);
+  }
+
+  // ------------------------------------------------------------------
+  // Write a snapshot, and map it back
+  // ------------------------------------------------------------------
+  #ifdef APC_PAGE_MMAP
+  {
+    char path[] = "/tmp/apc_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    const char* names[3] = { "alpha", "beta", "gamma" };
+
+    {
+      apc::arena arena(4096);
+
+      Table* table = arena.allocate_new<Table>();
+      Entry* entries = arena.allocate_size<Entry>(3);
+
+      for(int i = 0; i < 3; i++) {
+        new (&entries[i]) Entry();
+        assert(entries[i].name.assign(arena, names[i], strlen(names[i])));
+        entries[i].value = (i + 1) * 10;
+      }
+
+      table->entries.assign(entries, 3);
+      table->largest = &entries[2];
+
+      assert(apc::snapshot_write(arena, path, table));
+
+      // The root must be in the arena.
+      int outside = 0;
+      assert(!apc::snapshot_write(arena, path, &outside));
+
+      // Only contiguous arenas can be written.
+      apc::arena grown(16);
+      grown.allocate_size<char>(64);
+      assert(!grown.data() && !apc::snapshot_write(grown, path));
+    }
+
+    apc::arena_snapshot snapshot(path);
+    assert(snapshot.loaded());
+
+    const Table* table = snapshot.root<Table>();
+    assert(
+      reinterpret_cast<const char*>(table) >= snapshot.data() &&
+      table->entries.size() == 3 &&
+      table->largest->value == 30
+    );
+
+    for(int i = 0; i < 3; i++) {
+      const Entry &entry = table->entries[i];
+
+      assert(
+        entry.value == (i + 1) * 10 &&
+        entry.name.size() == strlen(names[i]) &&
+        memcmp(entry.name.data(), names[i], entry.name.size()) == 0
+      );
+    }
+
+    snapshot.close();
+    assert(!snapshot.loaded() && !snapshot.root<Table>());
+
+    // Files that are not snapshots are rejected.
+    FILE* file = fopen(path, "wb");
+    fputs("not a snapshot, just some text in a file", file);
+    fclose(file);
+
+    assert(!snapshot.load(path) && !snapshot.loaded());
+    assert(!snapshot.load("/nonexistent/apc_snapshot"));
+
+    remove(path);
+  }
+  #endif
+}
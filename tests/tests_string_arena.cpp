@@ -22,4 +22,24 @@ int main() {
 
     assert(arena.used() == 6);
   }
+
+  // ------------------------------------------------------------------
+  // Arena string grows in place when it is the last allocation 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64 * 1024);
+
+    apc::str_dynamic<1> str(arena);
+
+    for(int i = 0; i < 1000; i++) str.append("x");
+
+    assert(
+      str.used() == 1000 &&
+      arena.used() == str.size() + 1
+    );
+
+    // Shrinking back to the static buffer frees the arena buffer.
+    str.resize(1);
+    assert(arena.used() == 0);
+  }
 }
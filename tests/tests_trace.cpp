@@ -0,0 +1,157 @@
+// COMPILE: g++ -std=c++11 -Wall -fsanitize=address tests_trace.cpp
+
+#define APC_TRACE 1
+
+#include "../src/arena.h"
+#include "../src/pool.h"
+#include "../src/vector.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+static std::vector<apc::trace_event> read_trace(const char* path) {
+  std::vector<apc::trace_event> events;
+  FILE* file = fopen(path, "rb");
+
+  assert(file);
+
+  char magic[sizeof(apc::trace_magic)];
+  assert(fread(magic, sizeof(magic), 1, file) == 1);
+  assert(memcmp(magic, apc::trace_magic, sizeof(magic)) == 0);
+
+  apc::trace_event event;
+
+  while(fread(&event, sizeof(event), 1, file) == 1) events.push_back(event);
+
+  fclose(file);
+
+  return events;
+}
+
+int main() {
+  std::cout << "Running Trace tests...\n";
+
+  const char* path = "tests_trace.bin";
+
+  static_assert(sizeof(apc::trace_event) == 32, "trace_event is 32 bytes");
+
+  // ------------------------------------------------------------------
+  // Nothing is recorded outside trace_start()/trace_stop()
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+    arena.allocate_raw(16);
+
+    assert(apc::trace_start(path));
+    // Only one trace at a time.
+    assert(!apc::trace_start(path));
+    apc::trace_stop();
+
+    arena.allocate_raw(16);
+
+    assert(read_trace(path).empty());
+  }
+
+  // ------------------------------------------------------------------
+  // Arena, pool and vector events
+  // ------------------------------------------------------------------
+  {
+    assert(apc::trace_start(path));
+
+    // Taken while the objects are alive.
+    uintptr_t arena_id;
+    uintptr_t pool_id;
+    void* first;
+    int* item;
+
+    {
+      apc::arena arena(1024);
+      arena_id = reinterpret_cast<uintptr_t>(&arena);
+
+      first = arena.allocate_raw(24, 8);
+      // Slow path, a new page.
+      arena.allocate_raw(2048, 16);
+      arena.reset();
+
+      apc::pool<int> pool(4);
+      pool_id = reinterpret_cast<uintptr_t>(&pool);
+
+      item = pool.allocate(1);
+      pool.deallocate(item);
+
+      apc::vector<int> vector;
+      vector.push(1);
+    }
+
+    apc::trace_stop();
+
+    std::vector<apc::trace_event> events = read_trace(path);
+
+    assert(events.size() >= 8);
+
+    assert(events[0].op == apc::trace_arena_allocate);
+    assert(events[0].object == arena_id);
+    assert(events[0].address == reinterpret_cast<uintptr_t>(first));
+    assert(events[0].size == 24 && events[0].alignment == 8);
+
+    assert(events[1].op == apc::trace_arena_allocate);
+    assert(events[1].size == 2048 && events[1].alignment == 16);
+
+    assert(events[2].op == apc::trace_arena_reset);
+
+    assert(events[3].op == apc::trace_pool_allocate);
+    assert(events[3].object == pool_id);
+    assert(events[3].address == reinterpret_cast<uintptr_t>(item));
+    assert(events[3].size == sizeof(int));
+
+    assert(events[4].op == apc::trace_pool_deallocate);
+    assert(events[4].address == reinterpret_cast<uintptr_t>(item));
+
+    // The vector grows, then is freed.
+    assert(events[5].op == apc::trace_vector_resize && events[5].size > 0);
+    assert(!(events[5].flags & apc::trace_flag_arena));
+
+    const apc::trace_event &freed = events[events.size() - 2];
+    assert(freed.op == apc::trace_vector_resize && freed.size == 0);
+
+    assert(events.back().op == apc::trace_arena_release);
+    assert(events.back().object == arena_id);
+  }
+
+  // ------------------------------------------------------------------
+  // In place resizes and give backs of the last arena allocation
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(1024);
+    void* ptr = arena.allocate_raw(16);
+
+    assert(apc::trace_start(path));
+
+    assert(arena.try_extend(ptr, 16, 64));
+    assert(!arena.try_extend(ptr, 16, 32));
+    assert(arena.free_last(ptr, 64));
+    assert(!arena.free_last(ptr, 64));
+
+    apc::trace_stop();
+
+    std::vector<apc::trace_event> events = read_trace(path);
+
+    // Only the ones that succeeded.
+    assert(events.size() == 2);
+
+    assert(events[0].op == apc::trace_arena_extend);
+    assert(events[0].address == reinterpret_cast<uintptr_t>(ptr));
+    assert(events[0].size == 64);
+
+    assert(events[1].op == apc::trace_arena_free_last);
+    assert(events[1].address == reinterpret_cast<uintptr_t>(ptr));
+    assert(events[1].size == 64);
+  }
+
+  remove(path);
+
+  std::cout << "All tests passed!\n";
+
+  return 0;
+}
@@ -4,6 +4,7 @@
 #include "../src/vector.h"
 #include <cassert>
 #include <iostream>
+#include <memory>
 
 int main() {
   std::cout << "Running apc::vector tests...\n";
@@ -652,4 +653,93 @@ int main() {
       arr[0] == 1 && arr[1] == 2
     );
   }
+
+  // ------------------------------------------------------------------
+  // Arena vector grows in place when it is the last allocation 
+  // ------------------------------------------------------------------
+  {
+    apc::arena arena(64 * 1024);
+    apc::vector<int> arr(arena, 1);
+
+    for(int i = 0; i < 1000; i++) arr.push(i);
+
+    // No abandoned buffers, the arena holds exactly the final buffer.
+    assert(
+      arr.used() == 1000 &&
+      arr[999] == 999 &&
+      arena.used() == sizeof(int) * arr.size()
+    );
+
+    // Shrinking gives the space back.
+    arr.shrink_to_fit();
+    assert(arena.used() == sizeof(int) * 1000);
+
+    // Another allocation after the vector forces a copy on the next grow.
+    int* other = arena.allocate_new<int>(5);
+    arr.push(1000);
+
+    assert(
+      *other == 5 &&
+      arr[1000] == 1000 &&
+      arena.used() == sizeof(int) * (1000 + 1 + arr.size())
+    );
+  }
+
+  // ------------------------------------------------------------------
+  // Growth policies
+  // ------------------------------------------------------------------
+  {
+    apc::vector<int> arr(10);
+    arr.growth(apc::growth_policy::geometric(3, 2));
+
+    for(int i = 0; i < 11; i++) arr.push(i);
+
+    assert(arr.size() == 15 && arr.used() == 11);
+
+    // The first buffer is one chunk.
+    apc::vector<int> chunked;
+    chunked.growth(apc::growth_policy::fixed(sizeof(int) * 8));
+    chunked.push(1);
+    assert(chunked.size() == 8);
+
+    for(int i = 0; i < 8; i++) chunked.push(i);
+
+    assert(chunked.size() == 16);
+
+    apc::vector<int> limited(4);
+    limited.growth(apc::growth_policy().limit(sizeof(int) * 6));
+
+    for(int i = 0; i < 6; i++) assert(limited.push(i));
+
+    assert(limited.size() == 6 && !limited.push(6));
+
+    // Copies keep the policy.
+    apc::vector<int> moved(std::move(limited));
+    assert(moved.growth().max_size == sizeof(int) * 6);
+  }
+
+  // ------------------------------------------------------------------
+  // Prefault and warm-up
+  // ------------------------------------------------------------------
+  {
+    apc::vector<int> arr(4);
+    arr.push(1);
+    arr.prefault();
+
+    assert(arr.warm(1000) && arr.size() >= 1001 && arr.used() == 1);
+
+    const size_t size = arr.size();
+
+    for(int i = 0; i < 1000; i++) arr.push(i);
+
+    assert(arr.size() == size && arr[1000] == 999);
+
+    apc::vector<int> limited(4);
+    limited.growth(apc::growth_policy().limit(sizeof(int) * 8));
+    assert(!limited.warm(100));
+
+    apc::arena arena(1024);
+    apc::vector<int> arena_arr(arena, 4);
+    assert(arena_arr.warm(100) && arena_arr.size() >= 100);
+  }
 }
@@ -0,0 +1,551 @@
+// COMPILE: g++ -std=c++11 -O3 -march=native trace_replay.cpp
+// USAGE: ./a.out [trace file]
+//
+// Replays an allocation trace (recorded with APC_TRACE, see src/trace.h)
+// against malloc and against the apc allocators, and reports throughput,
+// peak RSS and fragmentation for both.
+// Without a trace file a synthetic request workload is generated first.
+
+#include "../src/arena.h"
+#include "../src/pool.h"
+#include "../src/vector.h"
+#include "../src/string.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Clock = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+// An event with the object and address mapped to dense indexes, so the
+// replays do not spend their time in hash lookups.
+struct replay_event {
+  uint8_t op;
+  uint8_t flags;
+  uint32_t object;
+  // Index of the allocation for pool events and arena allocate, extend
+  // and free_last events.
+  uint32_t slot;
+  size_t size;
+  // Alignment of the allocation, for extend events the one it was made
+  // with.
+  size_t alignment;
+  // Size before an extend.
+  size_t old_size;
+};
+
+struct replay_trace {
+  std::vector<replay_event> events;
+  size_t objects = 0;
+  size_t slots = 0;
+  // Most bytes requested and not yet released at any point.
+  size_t peak_live = 0;
+};
+
+struct replay_result {
+  double event_ns;
+  long peak_kib;
+};
+
+static bool load(const char* path, replay_trace &trace) {
+  FILE* file = fopen(path, "rb");
+
+  if(!file) return false;
+
+  char magic[sizeof(apc::trace_magic)];
+
+  if(fread(magic, sizeof(magic), 1, file) != 1 ||
+    memcmp(magic, apc::trace_magic, sizeof(magic)) != 0
+  ) {
+    fclose(file);
+
+    return false;
+  }
+
+  std::unordered_map<uint64_t, uint32_t> objects;
+  // Live pool allocations by address, and live arena allocations by
+  // address per arena (a child arena allocates inside a parent page).
+  std::unordered_map<uint64_t, uint32_t> slots;
+  std::vector<std::unordered_map<uint64_t, uint32_t>> arena_slots;
+  // Size and alignment of every allocation, by slot.
+  std::vector<size_t> slot_sizes;
+  std::vector<size_t> slot_alignments;
+  std::vector<size_t> arena_live;
+  std::vector<size_t> buffer_live;
+  size_t live = 0;
+  apc::trace_event event;
+
+  while(fread(&event, sizeof(event), 1, file) == 1) {
+    replay_event replay = { event.op, event.flags, 0, 0, event.size, event.alignment, 0 };
+
+    auto object = objects.find(event.object);
+
+    if(object == objects.end())
+      object = objects.emplace(event.object, static_cast<uint32_t>(objects.size())).first;
+
+    replay.object = object->second;
+
+    if(arena_live.size() <= replay.object) {
+      arena_live.resize(replay.object + 1, 0);
+      buffer_live.resize(replay.object + 1, 0);
+      arena_slots.resize(replay.object + 1);
+    }
+
+    switch(event.op) {
+      case apc::trace_arena_allocate:
+        replay.slot = static_cast<uint32_t>(trace.slots++);
+        slot_sizes.push_back(event.size);
+        slot_alignments.push_back(event.alignment);
+        arena_slots[replay.object][event.address] = replay.slot;
+        arena_live[replay.object] += event.size;
+        live += event.size;
+        break;
+      case apc::trace_arena_extend:
+      case apc::trace_arena_free_last: {
+        auto slot = arena_slots[replay.object].find(event.address);
+
+        if(slot == arena_slots[replay.object].end()) continue;
+
+        replay.slot = slot->second;
+        replay.old_size = slot_sizes[replay.slot];
+        replay.alignment = slot_alignments[replay.slot];
+
+        const size_t size = event.op == apc::trace_arena_extend ? event.size : 0;
+
+        arena_live[replay.object] += size - replay.old_size;
+        live += size - replay.old_size;
+        slot_sizes[replay.slot] = size;
+
+        if(!size) arena_slots[replay.object].erase(slot);
+        break;
+      }
+      case apc::trace_arena_reset:
+      case apc::trace_arena_release:
+        arena_slots[replay.object].clear();
+        live -= arena_live[replay.object];
+        arena_live[replay.object] = 0;
+        break;
+      case apc::trace_pool_allocate:
+        replay.slot = static_cast<uint32_t>(trace.slots++);
+        slot_sizes.push_back(event.size);
+        slot_alignments.push_back(event.alignment);
+        slots[event.address] = replay.slot;
+        live += event.size;
+        break;
+      case apc::trace_pool_deallocate: {
+        auto slot = slots.find(event.address);
+
+        if(slot == slots.end()) continue;
+
+        replay.slot = slot->second;
+        replay.alignment = slot_alignments[replay.slot];
+        live -= slot_sizes[replay.slot];
+        slots.erase(slot);
+        break;
+      }
+      case apc::trace_vector_resize:
+      case apc::trace_str_resize:
+        if(event.flags & apc::trace_flag_arena) continue;
+
+        live -= buffer_live[replay.object];
+        buffer_live[replay.object] = event.size;
+        live += event.size;
+        break;
+      default:
+        continue;
+    }
+
+    if(live > trace.peak_live) trace.peak_live = live;
+
+    trace.events.push_back(replay);
+  }
+
+  trace.objects = objects.size();
+  fclose(file);
+
+  return true;
+}
+
+static void* aligned_malloc(const size_t size, const size_t alignment) {
+  if(alignment <= alignof(std::max_align_t)) return malloc(size);
+
+  void* ptr = nullptr;
+
+  return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+}
+
+// realloc() does not keep an alignment above max_align_t.
+static void* aligned_realloc(void* ptr, const size_t old_size, const size_t size,
+  const size_t alignment
+) {
+  if(alignment <= alignof(std::max_align_t)) return realloc(ptr, size);
+
+  void* resized = aligned_malloc(size, alignment);
+
+  if(resized) {
+    memcpy(resized, ptr, old_size < size ? old_size : size);
+    free(ptr);
+  }
+
+  return resized;
+}
+
+static size_t replay_malloc(const replay_trace &trace) {
+  std::vector<std::vector<uint32_t>> arenas(trace.objects);
+  std::vector<void*> slots(trace.slots, nullptr);
+  std::vector<void*> buffers(trace.objects, nullptr);
+  size_t sum = 0;
+
+  for(const replay_event &event : trace.events) {
+    switch(event.op) {
+      case apc::trace_arena_allocate:
+        slots[event.slot] = aligned_malloc(event.size, event.alignment);
+        arenas[event.object].push_back(event.slot);
+        sum += reinterpret_cast<uintptr_t>(slots[event.slot]);
+        break;
+      case apc::trace_arena_extend: {
+        void* resized = aligned_realloc(slots[event.slot], event.old_size,
+          event.size, event.alignment);
+
+        if(resized) slots[event.slot] = resized;
+        break;
+      }
+      case apc::trace_arena_free_last:
+        free(slots[event.slot]);
+        slots[event.slot] = nullptr;
+        break;
+      case apc::trace_arena_reset:
+      case apc::trace_arena_release:
+        for(const uint32_t slot : arenas[event.object]) {
+          free(slots[slot]);
+          slots[slot] = nullptr;
+        }
+
+        arenas[event.object].clear();
+        break;
+      case apc::trace_pool_allocate:
+        slots[event.slot] = aligned_malloc(event.size, event.alignment);
+        sum += reinterpret_cast<uintptr_t>(slots[event.slot]);
+        break;
+      case apc::trace_pool_deallocate:
+        free(slots[event.slot]);
+        break;
+      default: {
+        // Vectors/strs without an arena realloc their buffer.
+        void* &buffer = buffers[event.object];
+
+        if(!event.size) {
+          free(buffer);
+          buffer = nullptr;
+        } else {
+          void* resized = realloc(buffer, event.size);
+
+          if(resized) buffer = resized;
+        }
+      }
+    }
+  }
+
+  for(void* buffer : buffers) free(buffer);
+
+  return sum;
+}
+
+template <size_t S>
+struct alignas(std::max_align_t) replay_block {
+  char data[S];
+};
+
+// Pools for the objects of the traced pools, by size. The blocks are
+// aligned to max_align_t, over-aligned objects go to aligned_malloc().
+struct replay_pools {
+  apc::pool<replay_block<16>> pool16;
+  apc::pool<replay_block<32>> pool32;
+  apc::pool<replay_block<64>> pool64;
+  apc::pool<replay_block<128>> pool128;
+  apc::pool<replay_block<256>> pool256;
+  apc::pool<replay_block<512>> pool512;
+
+  void* allocate(const size_t size, const size_t alignment) {
+    if(alignment > alignof(std::max_align_t)) return aligned_malloc(size, alignment);
+
+    if(size <= 16) return pool16.allocate_raw();
+    if(size <= 32) return pool32.allocate_raw();
+    if(size <= 64) return pool64.allocate_raw();
+    if(size <= 128) return pool128.allocate_raw();
+    if(size <= 256) return pool256.allocate_raw();
+    if(size <= 512) return pool512.allocate_raw();
+
+    return aligned_malloc(size, alignment);
+  }
+
+  void deallocate(void* ptr, const size_t size, const size_t alignment) {
+    if(alignment > alignof(std::max_align_t)) free(ptr);
+    else if(size <= 16) pool16.deallocate(static_cast<replay_block<16>*>(ptr));
+    else if(size <= 32) pool32.deallocate(static_cast<replay_block<32>*>(ptr));
+    else if(size <= 64) pool64.deallocate(static_cast<replay_block<64>*>(ptr));
+    else if(size <= 128) pool128.deallocate(static_cast<replay_block<128>*>(ptr));
+    else if(size <= 256) pool256.deallocate(static_cast<replay_block<256>*>(ptr));
+    else if(size <= 512) pool512.deallocate(static_cast<replay_block<512>*>(ptr));
+    else free(ptr);
+  }
+};
+
+static size_t replay_apc(const replay_trace &trace) {
+  std::vector<apc::arena*> arenas(trace.objects, nullptr);
+  std::vector<void*> slots(trace.slots, nullptr);
+  std::vector<apc::vector<char>*> vectors(trace.objects, nullptr);
+  std::vector<apc::str*> strs(trace.objects, nullptr);
+  replay_pools pools;
+  size_t sum = 0;
+
+  for(const replay_event &event : trace.events) {
+    switch(event.op) {
+      case apc::trace_arena_allocate: {
+        apc::arena* &arena = arenas[event.object];
+
+        if(!arena) arena = new apc::arena(4096);
+
+        slots[event.slot] = arena->allocate_raw(event.size, event.alignment);
+        sum += reinterpret_cast<uintptr_t>(slots[event.slot]);
+        break;
+      }
+      case apc::trace_arena_extend: {
+        apc::arena* arena = arenas[event.object];
+
+        if(!arena || !slots[event.slot]) break;
+
+        if(arena->try_extend(slots[event.slot], event.old_size, event.size)) break;
+
+        // The replay arena has other page sizes than the traced one, so
+        // the allocation may not be last on its page. Move it instead.
+        void* moved = arena->allocate_raw(event.size, event.alignment);
+
+        if(moved) {
+          memcpy(moved, slots[event.slot],
+            event.old_size < event.size ? event.old_size : event.size);
+          slots[event.slot] = moved;
+        }
+        break;
+      }
+      case apc::trace_arena_free_last:
+        if(arenas[event.object])
+          arenas[event.object]->free_last(slots[event.slot], event.old_size);
+        break;
+      case apc::trace_arena_reset:
+        if(arenas[event.object]) arenas[event.object]->reset();
+        break;
+      case apc::trace_arena_release:
+        delete arenas[event.object];
+        arenas[event.object] = nullptr;
+        break;
+      case apc::trace_pool_allocate:
+        slots[event.slot] = pools.allocate(event.size, event.alignment);
+        sum += reinterpret_cast<uintptr_t>(slots[event.slot]);
+        break;
+      case apc::trace_pool_deallocate:
+        pools.deallocate(slots[event.slot], event.size, event.alignment);
+        break;
+      case apc::trace_vector_resize: {
+        apc::vector<char>* &vector = vectors[event.object];
+
+        if(!event.size) {
+          delete vector;
+          vector = nullptr;
+        } else {
+          if(!vector) vector = new apc::vector<char>();
+
+          vector->resize(event.size);
+        }
+        break;
+      }
+      case apc::trace_str_resize: {
+        apc::str* &str = strs[event.object];
+
+        if(!event.size) {
+          delete str;
+          str = nullptr;
+        } else {
+          if(!str) str = new apc::str();
+
+          // The size includes the terminator.
+          str->resize(event.size - 1);
+        }
+        break;
+      }
+    }
+  }
+
+  for(apc::arena* arena : arenas) delete arena;
+  for(apc::vector<char>* vector : vectors) delete vector;
+  for(apc::str* str : strs) delete str;
+
+  return sum;
+}
+
+static long rss_kib() {
+  long pages = 0, resident = 0;
+  FILE* file = fopen("/proc/self/statm", "r");
+
+  if(!file) return 0;
+
+  if(fscanf(file, "%ld %ld", &pages, &resident) != 2) resident = 0;
+
+  fclose(file);
+
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Run `replay` in a child process, so every replay starts from the same
+// heap and gets its own peak RSS.
+static replay_result run(size_t (*replay)(const replay_trace&), const replay_trace &trace) {
+  replay_result result = { 0, 0 };
+  int fds[2];
+
+  if(pipe(fds) != 0) return result;
+
+  pid_t pid = fork();
+
+  if(pid == 0) {
+    close(fds[0]);
+
+    const long baseline = rss_kib();
+
+    auto t0 = Clock::now();
+    size_t sum = replay(trace);
+    auto t1 = Clock::now();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    result.event_ns = std::chrono::duration_cast<ns>(t1 - t0).count() /
+      double(trace.events.size() ? trace.events.size() : 1);
+    result.peak_kib = usage.ru_maxrss - baseline;
+
+    if(write(fds[1], &result, sizeof(result)) != sizeof(result)) sum = 0;
+
+    _exit(sum == 0);
+  }
+
+  close(fds[1]);
+
+  if(read(fds[0], &result, sizeof(result)) != sizeof(result)) result = { 0, 0 };
+
+  close(fds[0]);
+  waitpid(pid, nullptr, 0);
+
+  return result;
+}
+
+// A request loop with mixed sizes and lifetimes: scratch allocations in a
+// per-request arena, long lived pool objects and growing buffers.
+static bool generate(const char* path) {
+  if(!apc::trace_start(path)) return false;
+
+  uint32_t seed = 12345;
+  auto random = [&seed](const uint32_t max) {
+    seed = seed * 1664525 + 1013904223;
+
+    return (seed >> 8) % max;
+  };
+
+  char arena_id, pool_id, buffer_id;
+  std::vector<uintptr_t> live;
+  uintptr_t address = 1;
+
+  for(size_t request = 0; request < 2000; request++) {
+    for(size_t i = 0; i < 200; i++) {
+      // Mostly small, sometimes big.
+      const size_t size = random(10) ? 16 + random(240) : 1024 + random(16 * 1024);
+
+      const void* ptr = reinterpret_cast<void*>(address++);
+
+      apc::trace_record(apc::trace_arena_allocate, &arena_id, ptr, size,
+        random(8) ? 8 : 64);
+
+      // Some of them grow in place, or are given back right away.
+      if(!random(20))
+        apc::trace_record(apc::trace_arena_extend, &arena_id, ptr, size * 2);
+      else if(!random(20))
+        apc::trace_record(apc::trace_arena_free_last, &arena_id, ptr, size);
+    }
+
+    for(size_t i = 0; i < 20; i++) {
+      // A few cache line aligned ones.
+      apc::trace_record(apc::trace_pool_allocate, &pool_id,
+        reinterpret_cast<void*>(address), 96, random(10) ? 8 : 64);
+      live.push_back(address++);
+    }
+
+    // Free most of the pool objects after a while.
+    while(live.size() > 500) {
+      const size_t index = random(static_cast<uint32_t>(live.size()));
+
+      apc::trace_record(apc::trace_pool_deallocate, &pool_id,
+        reinterpret_cast<void*>(live[index]), 96);
+      live[index] = live.back();
+      live.pop_back();
+    }
+
+    for(size_t size = 64; size <= 64 * 1024; size *= 2)
+      apc::trace_record(apc::trace_vector_resize, &buffer_id,
+        reinterpret_cast<void*>(address++), size, 8);
+
+    apc::trace_record(apc::trace_vector_resize, &buffer_id, nullptr, 0, 8);
+    apc::trace_record(apc::trace_arena_reset, &arena_id, nullptr, 0);
+  }
+
+  apc::trace_record(apc::trace_arena_release, &arena_id, nullptr, 0);
+  apc::trace_stop();
+
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "trace_replay.bin";
+
+  if(argc < 2 && !generate(path)) {
+    printf("Could not write %s\n", path);
+
+    return 1;
+  }
+
+  replay_trace trace;
+
+  if(!load(path, trace)) {
+    printf("Could not read %s\n", path);
+
+    return 1;
+  }
+
+  printf("Replaying %zu events (%zu objects), peak live %zu KiB\n",
+    trace.events.size(), trace.objects, trace.peak_live / 1024);
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  const char* names[2] = { "malloc     ", "apc        " };
+  size_t (*replays[2])(const replay_trace&) = { replay_malloc, replay_apc };
+
+  for(size_t i = 0; i < 2; i++) {
+    replay_result result = run(replays[i], trace);
+    const double peak = static_cast<double>(result.peak_kib) * 1024;
+    const double fragmentation = peak > trace.peak_live ?
+      (peak - trace.peak_live) / peak * 100 : 0;
+
+    std::cout << names[i] << "event: " << std::setw(8) << result.event_ns << " ns"
+              << "  (" << std::setw(8) << 1000 / result.event_ns << " M events/s)"
+              << "  peak RSS: " << std::setw(8) << result.peak_kib << " KiB"
+              << "  fragmentation: " << std::setw(6) << fragmentation << " %\n";
+  }
+
+  if(argc < 2) remove(path);
+
+  return 0;
+}